@@ -1,14 +1,24 @@
 #include "allocation_controller.hpp"
 #include "host_allocation_policies/first.hpp"
 #include "tree_building_policies/first.hpp"
+#include "utils/trace.hpp"
 #include "utils/union_find.hpp"
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <nlohmann/json.hpp>
+#include <unordered_set>
+
+// The number of transmissions per job in a sharing group to look for a period in, before starting over
+constexpr unsigned int PERIOD_DETECTION_WINDOW = 1024;
+// Arrivals run after the events of the running jobs at the same time
+constexpr unsigned int ARRIVAL_EVENT_ORDER = std::numeric_limits<unsigned int>::max();
 
 void to_json(nlohmann::json &json, const SimulationResult &result) {
     json = {
@@ -17,6 +27,8 @@ void to_json(nlohmann::json &json, const SimulationResult &result) {
         {"SharpRatio", result.SharpRatio()},
         {"SharpRatioWeighted", result.SharpRatioWeighted()},
         {"FinishedJobCount", result.FinishedJobCount},
+        {"StartedJobCount", result.StartedJobCount},
+        {"PendingJobCount", result.PendingJobCount},
         {"SimulatedTime", result.SimulatedTime},
         {"EventCount", result.EventCount},
         {"ClusterUtilization", result.ClusterUtilization},
@@ -30,6 +42,11 @@ void to_json(nlohmann::json &json, const SimulationResult &result) {
         {"TotalSharpTime", result.TotalSharpTime},
         {"TotalSharpTimeWeighted", result.TotalSharpTimeWeighted},
         {"TotalSharpUsage", result.TotalSharpUsage},
+        {"TotalQueueingDelay", result.TotalQueueingDelay},
+        {"MeanQueueingDelay", result.MeanQueueingDelay()},
+        {"MaxQueueingDelay", result.MaxQueueingDelay},
+        {"TotalJCTWithQueueing", result.TotalJCTWithQueueing},
+        {"TotalJCTWithQueueingWeighted", result.TotalJCTWithQueueingWeighted},
         {"TimeCostHostAllocation", result.TimeCostHostAllocation},
         {"TimeCostTreeBuilding", result.TimeCostTreeBuilding},
         {"TreeMigrationCount", result.TreeMigrationCount},
@@ -45,6 +62,8 @@ std::ostream &operator<<(std::ostream &os, const SimulationResult &result) {
     os << "  SharpRatio:                   " << result.SharpRatio() * 100 << "%\n";
     os << "  SharpRatioWeighted:           " << result.SharpRatioWeighted() * 100 << "%\n";
     os << "  FinishedJobCount:             " << result.FinishedJobCount << '\n';
+    os << "  StartedJobCount:              " << result.StartedJobCount << '\n';
+    os << "  PendingJobCount:              " << result.PendingJobCount << '\n';
     os << "  SimulatedTime:                " << result.SimulatedTime << " sec\n";
     os << "  EventCount:                   " << result.EventCount << '\n';
     os << "  ClusterUtilization:           " << result.ClusterUtilization * 100 << "%\n";
@@ -58,6 +77,10 @@ std::ostream &operator<<(std::ostream &os, const SimulationResult &result) {
     os << "  TotalSharpTime:               " << result.TotalSharpTime << " sec\n";
     os << "  TotalSharpTimeWeighted:       " << result.TotalSharpTimeWeighted << " sec\n";
     os << "  TotalSharpUsage:              " << result.TotalSharpUsage << " sec\n";
+    os << "  MeanQueueingDelay:            " << result.MeanQueueingDelay() << " sec\n";
+    os << "  MaxQueueingDelay:             " << result.MaxQueueingDelay << " sec\n";
+    os << "  TotalJCTWithQueueing:         " << result.TotalJCTWithQueueing << " sec\n";
+    os << "  TotalJCTWithQueueingWeighted: " << result.TotalJCTWithQueueingWeighted << " sec\n";
     os << "  TimeCostHostAllocation:       " << result.TimeCostHostAllocation << " ms (wall clock)\n";
     os << "  TimeCostTreeBuilding:         " << result.TimeCostTreeBuilding << " ms (wall clock)\n";
     os << "  TreeMigrationCount:           " << result.TreeMigrationCount << '\n';
@@ -66,58 +89,214 @@ std::ostream &operator<<(std::ostream &os, const SimulationResult &result) {
     return os;
 }
 
-void AllocationController::BuildSharingGroups() {
-    UnionFind u(m_RunningJobs.size());
-    for (unsigned int i = 0; i < m_RunningJobs.size(); ++i) {
-        const auto &aggrTree1 = m_RunningJobs[i]->GetNextAggrTree();
-        if (!aggrTree1)
+SharingGroup *AllocationController::CreateSharingGroup(std::vector<Job *> &&jobs) {
+    auto sharingGroup = std::make_unique<SharingGroup>(std::move(jobs), &m_Resources, m_SharingPolicy);
+    sharingGroup->SetBeforeTransmissionCallback([this](const Job &job, double, bool useSharp) {
+        if (useSharp) {
+            const auto &aggrTree = job.GetCurrentAggrTree();
+            assert(aggrTree);
+            m_Resources.Allocate(*aggrTree);
+        }
+    });
+    sharingGroup->SetAfterTransmissionCallback([this](const Job &job, double, bool useSharp) {
+        if (useSharp) {
+            const auto &aggrTree = job.GetCurrentAggrTree();
+            assert(aggrTree);
+            m_Resources.Deallocate(*aggrTree);
+        }
+    });
+    for (auto job : sharingGroup->GetJobs())
+        m_SharingGroupMemberships[job->ID] = {sharingGroup.get(), job->GetNextAggrTreeVersion(), 0};
+    auto group = sharingGroup.get();
+    m_SharingGroups[group] = std::move(sharingGroup);
+    return group;
+}
+
+void AllocationController::ResetPeriodDetector(const SharingGroup *group) {
+    auto iter = m_PeriodDetectors.find(group);
+    if (iter == m_PeriodDetectors.end())
+        return;
+    if (iter->second.IsExtrapolating)
+        for (auto job : group->GetJobs())
+            job->StopFastForward();
+    m_PeriodDetectors.erase(iter);
+}
+
+SharingGroup *AllocationController::MergeSharingGroups(SharingGroup *group1, SharingGroup *group2) {
+    if (group1 == group2)
+        return group1;
+    ResetPeriodDetector(group1);
+    ResetPeriodDetector(group2);
+    if (group1->GetJobs().size() < group2->GetJobs().size())
+        std::swap(group1, group2);
+    for (auto job : group2->GetJobs()) {
+        group1->AddJob(job);
+        m_SharingGroupMemberships[job->ID].Group = group1;
+    }
+    m_SharingGroups.erase(group2);
+    return group1;
+}
+
+void AllocationController::SplitSharingGroup(SharingGroup *group) {
+    ResetPeriodDetector(group);
+    auto jobs = group->GetJobs();
+    if (jobs.empty()) {
+        m_SharingGroups.erase(group);
+        return;
+    }
+    std::unordered_map<unsigned int, unsigned int> jobIdToIdx;
+    for (unsigned int i = 0; i < jobs.size(); ++i)
+        jobIdToIdx[jobs[i]->ID] = i;
+    UnionFind u(jobs.size());
+    for (unsigned int i = 0; i < jobs.size(); ++i) {
+        const auto &aggrTree = jobs[i]->GetNextAggrTree();
+        if (!aggrTree)
             continue;
-        for (unsigned int j = i + 1; j < m_RunningJobs.size(); ++j) {
-            const auto &aggrTree2 = m_RunningJobs[j]->GetNextAggrTree();
-            if (!aggrTree2)
-                continue;
-            if (m_Resources.CheckTreeConflict(*aggrTree1, *aggrTree2))
-                u.Union(i, j);
+        for (auto jobId : m_Resources.GetConflictingTrees(*aggrTree)) {
+            auto iter = jobIdToIdx.find(jobId);
+            if (iter != jobIdToIdx.end())
+                u.Union(i, iter->second);
         }
     }
-    m_SharingGroups.clear();
-    for (const auto &[_, group] : u.Group()) {
-        std::vector<Job *> jobs;
-        for (auto i : group)
-            jobs.push_back(m_RunningJobs[i].get());
-        auto sharingGroup = std::make_unique<SharingGroup>(std::move(jobs), &m_Resources, m_SharingPolicy);
-        sharingGroup->SetBeforeTransmissionCallback([this](const Job &job, double, bool useSharp) {
-            if (useSharp) {
-                const auto &aggrTree = job.GetCurrentAggrTree();
-                assert(aggrTree);
-                m_Resources.Allocate(*aggrTree);
-            }
-        });
-        sharingGroup->SetAfterTransmissionCallback([this](const Job &job, double, bool useSharp) {
-            if (useSharp) {
-                const auto &aggrTree = job.GetCurrentAggrTree();
-                assert(aggrTree);
-                m_Resources.Deallocate(*aggrTree);
-            }
-        });
-        m_SharingGroups.push_back(std::move(sharingGroup));
+    auto firstRoot = u.Find(0);
+    for (const auto &[root, component] : u.Group()) {
+        if (root == firstRoot)
+            continue;
+        std::vector<Job *> newGroupJobs;
+        for (auto i : component) {
+            group->RemoveJob(jobs[i]);
+            newGroupJobs.push_back(jobs[i]);
+        }
+        CreateSharingGroup(std::move(newGroupJobs));
+    }
+}
+
+void AllocationController::RemoveFromSharingGroup(Job *job) {
+    auto iter = m_SharingGroupMemberships.find(job->ID);
+    assert(iter != m_SharingGroupMemberships.end());
+    auto group = iter->second.Group;
+    m_SharingGroupMemberships.erase(iter);
+    if (m_Resources.IsTreeRegistered(job->ID))
+        m_Resources.UnregisterTree(job->ID);
+    group->RemoveJob(job);
+    SplitSharingGroup(group);
+}
+
+void AllocationController::UpdateSharingGroups(const std::vector<Job *> &newJobs) {
+    // Detach the jobs whose aggregation trees have changed, their old groups may fall apart
+    std::vector<Job *> changedJobs = newJobs;
+    std::unordered_set<SharingGroup *> affectedGroups;
+    for (const auto &job : m_RunningJobs) {
+        auto iter = m_SharingGroupMemberships.find(job->ID);
+        if (iter == m_SharingGroupMemberships.end() ||
+            iter->second.AggrTreeVersion == job->GetNextAggrTreeVersion())
+            continue;
+        iter->second.Group->RemoveJob(job.get());
+        affectedGroups.insert(iter->second.Group);
+        m_SharingGroupMemberships.erase(iter);
+        if (m_Resources.IsTreeRegistered(job->ID))
+            m_Resources.UnregisterTree(job->ID);
+        changedJobs.push_back(job.get());
+    }
+    for (auto group : affectedGroups)
+        SplitSharingGroup(group);
+    // Then re-attach them, merging all groups they conflict with
+    for (auto job : changedJobs) {
+        if (job->GetNextAggrTree())
+            m_Resources.RegisterTree(job->ID, *job->GetNextAggrTree());
+        CreateSharingGroup({job});
+    }
+    for (auto job : changedJobs) {
+        const auto &aggrTree = job->GetNextAggrTree();
+        if (!aggrTree)
+            continue;
+        for (auto otherJobId : m_Resources.GetConflictingTrees(*aggrTree))
+            MergeSharingGroups(m_SharingGroupMemberships[job->ID].Group,
+                               m_SharingGroupMemberships[otherJobId].Group);
+    }
+}
+
+void AllocationController::UpdateEventOrders() {
+    std::vector<Job *> jobs;
+    for (const auto &job : m_RunningJobs)
+        jobs.push_back(job.get());
+    std::sort(jobs.begin(), jobs.end(), [](const Job *job1, const Job *job2) { return job1->ID < job2->ID; });
+    std::unordered_map<unsigned int, unsigned int> jobIdToIdx;
+    for (unsigned int i = 0; i < jobs.size(); ++i)
+        jobIdToIdx[jobs[i]->ID] = i;
+    // Join the conflicting pairs in the same order as a pairwise scan, so that the roots are the same
+    UnionFind u(jobs.size());
+    std::vector<unsigned int> laterNeighbors;
+    for (unsigned int i = 0; i < jobs.size(); ++i) {
+        const auto &aggrTree = jobs[i]->GetNextAggrTree();
+        if (!aggrTree)
+            continue;
+        laterNeighbors.clear();
+        for (auto jobId : m_Resources.GetConflictingTrees(*aggrTree)) {
+            auto iter = jobIdToIdx.find(jobId);
+            assert(iter != jobIdToIdx.end());
+            if (iter->second > i)
+                laterNeighbors.push_back(iter->second);
+        }
+        std::sort(laterNeighbors.begin(), laterNeighbors.end());
+        for (auto j : laterNeighbors)
+            u.Union(i, j);
+    }
+    unsigned int eventOrder = 0;
+    for (const auto &[_, component] : u.Group())
+        for (auto i : component)
+            m_SharingGroupMemberships[jobs[i]->ID].EventOrder = eventOrder++;
+}
+
+void AllocationController::RebuildEventQueue(double now) {
+    UpdateEventOrders();
+    m_ArrivalEventIdx = m_RunningJobs.GetSlotCount();
+    m_EventQueue.Reset(m_ArrivalEventIdx + 1);
+    for (unsigned int i = 0; i < m_RunningJobs.Size(); ++i) {
+        const auto &job = m_RunningJobs.GetItems()[i];
+        m_EventQueue.Push(m_RunningJobs.GetSlotIdx(i),
+                          {job->GetNextEvent(now), m_SharingGroupMemberships[job->ID].EventOrder});
     }
+    UpdateArrivalEvent();
 }
 
-void AllocationController::RunNewJobs(SimulationResult &result) {
+void AllocationController::UpdateArrivalEvent() {
+    if (m_NextJob)
+        m_EventQueue.Update(m_ArrivalEventIdx, {m_NextJob->ArrivalTime, ARRIVAL_EVENT_ORDER});
+    else if (m_EventQueue.Contains(m_ArrivalEventIdx))
+        m_EventQueue.Remove(m_ArrivalEventIdx);
+}
+
+void AllocationController::ReceiveArrivedJobs(double now) {
+    while (m_NextJob && m_NextJob->ArrivalTime <= now) {
+        assert(&m_NextJob->Context == &m_Context);
+        [[maybe_unused]] auto arrivalTime = m_NextJob->ArrivalTime;
+        m_PendingJobs.Push(std::move(m_NextJob));
+        m_NextJob = m_GetNextJob();
+        assert(!m_NextJob || m_NextJob->ArrivalTime >= arrivalTime);
+    }
+}
+
+void AllocationController::RunNewJobs(SimulationResult &result, double now, bool runningJobsChanged) {
+    ReceiveArrivedJobs(now);
     std::vector<Job *> newJobs;
-    while (m_NextJob) {
+    auto tryAdmit = [&](const Job &pendingJob) {
         auto start = std::chrono::high_resolution_clock::now();
-        auto hosts = m_HostAllocationPolicy(m_Resources, m_NextJob->HostCount);
+        auto hosts = m_HostAllocationPolicy(m_Resources, pendingJob.HostCount);
         auto finish = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
         result.TimeCostHostAllocation += duration.count() / 1000.0;
         if (!hosts)
-            break;
+            return false;
+        auto job = m_PendingJobs.Take(pendingJob);
         m_Resources.Allocate(*hosts);
-        m_NextJob->SetHosts(std::move(*hosts));
-        newJobs.push_back(m_NextJob.get());
-        m_RunningJobs.push_back(std::move(m_NextJob));
+        job->SetHosts(std::move(*hosts));
+        // The job starts right away, see Job::GetNextEvent
+        auto queueingDelay = now - job->ArrivalTime;
+        result.TotalQueueingDelay += queueingDelay;
+        result.MaxQueueingDelay = std::max(result.MaxQueueingDelay, queueingDelay);
+        newJobs.push_back(job.get());
+        m_RunningJobs.Insert(std::move(job));
         ++m_AllocatedJobCount;
         if (RecordClusterState.has_value() && RecordClusterState.value() == m_AllocatedJobCount) {
             std::vector<std::vector<unsigned int>> clusterState;
@@ -129,10 +308,18 @@ void AllocationController::RunNewJobs(SimulationResult &result) {
             std::ofstream file(ClusterStateOutputFile);
             file << nlohmann::json(clusterState);
         }
-        m_NextJob = m_GetNextJob();
+        return true;
+    };
+    if (!m_PendingJobs.Empty())
+        m_SchedulingPolicy(m_Resources, m_RunningJobs.GetItems(), m_PendingJobs, now, tryAdmit);
+    if (!newJobs.empty())
+        m_PendingJobs.RemoveTaken();
+    else if (!runningJobsChanged) {
+        UpdateArrivalEvent();
+        return;
     }
     auto start = std::chrono::high_resolution_clock::now();
-    m_TreeBuildingPolicy(m_Resources, m_RunningJobs, newJobs);
+    m_TreeBuildingPolicy(m_Resources, m_RunningJobs.GetItems(), newJobs);
     auto finish = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
     result.TimeCostTreeBuilding += duration.count() / 1000.0;
@@ -144,23 +331,198 @@ void AllocationController::RunNewJobs(SimulationResult &result) {
             m_Resources.CalcHostFragments(true),
         };
     }
-    BuildSharingGroups();
+    m_MigratingJobs.clear();
+    for (const auto &job : m_RunningJobs)
+        if (job->IsMigratingAggrTree())
+            m_MigratingJobs.push_back(job.get());
+    UpdateSharingGroups(newJobs);
+    // The sharing groups may have changed
+    if (m_Tracer)
+        for (const auto &job : m_RunningJobs) {
+            auto isTraced = IsTraced(*job);
+            if (!isTraced)
+                m_Tracer->EndOpenEvents(now, *job);
+            job->SetTracer(isTraced ? m_Tracer.get() : nullptr);
+        }
+    // The schedules of the fast-forwarding jobs no longer hold if they are no longer alone or free of contention
+    for (const auto &job : m_RunningJobs) {
+        if (!job->IsFastForwarding())
+            continue;
+        auto group = m_SharingGroupMemberships[job->ID].Group;
+        auto iter = m_PeriodDetectors.find(group);
+        if (iter != m_PeriodDetectors.end() && iter->second.IsExtrapolating) {
+            if (HasTreeContention(*job))
+                ResetPeriodDetector(group);
+        } else if (group->GetJobs().size() > 1 || HasTreeContention(*job))
+            job->StopFastForward();
+    }
+    RebuildEventQueue(now);
 }
 
-std::tuple<double, Job *, SharingGroup *> AllocationController::GetNextEvent(double now) {
-    double nearestEventTime;
-    Job *nearestJob = nullptr;
-    SharingGroup *nearestSharingGroup = nullptr;
-    for (auto &sharingGroup : m_SharingGroups) {
-        auto [nextEventTime, nextJob] = sharingGroup->GetNextEvent(now);
-        if (!nearestJob || nextEventTime < nearestEventTime) {
-            nearestEventTime = nextEventTime;
-            nearestJob = nextJob;
-            nearestSharingGroup = sharingGroup.get();
-        }
+std::pair<double, unsigned int> AllocationController::GetNextEvent() const {
+    assert(!m_EventQueue.Empty());
+    return {m_EventQueue.TopKey().first, m_EventQueue.Top()};
+}
+
+void AllocationController::UpdateNextEvent(unsigned int slotIdx, double now) {
+    const auto &job = m_RunningJobs[slotIdx];
+    m_EventQueue.Update(slotIdx, {job->GetNextEvent(now), m_EventQueue.GetKey(slotIdx).second});
+}
+
+bool AllocationController::HasTreeContention(const Job &job) {
+    const auto &aggrTree = job.GetCurrentAggrTree();
+    if (!aggrTree)
+        return false;
+    m_MigratingJobs.erase(std::remove_if(m_MigratingJobs.begin(), m_MigratingJobs.end(),
+                                         [](const Job *job) { return !job->IsMigratingAggrTree(); }),
+                          m_MigratingJobs.end());
+    for (auto migratingJob : m_MigratingJobs)
+        if (m_Resources.CheckTreeConflict(*migratingJob->GetCurrentAggrTree(), *aggrTree))
+            return true;
+    return false;
+}
+
+bool AllocationController::IsFastForwardAllowed() const {
+    // The callbacks are skipped while fast-forwarding, so are the traces and the sharing overhead
+    if (!EnableFastForward || m_Tracer || m_Context.RecordSharingOverhead)
+        return false;
+    // With a quota of two or more, jobs in different sharing groups may still run out of SHARP resources
+    return (!m_Resources.NodeQuota || *m_Resources.NodeQuota < 2) &&
+           (!m_Resources.LinkQuota || *m_Resources.LinkQuota < 2);
+}
+
+void AllocationController::TryFastForward(const SharingGroup &group, Job *job, double now) {
+    if (!IsFastForwardAllowed() || group.GetJobs().size() > 1 || !job->CanFastForward(now, m_MaxSimulationTime))
+        return;
+    // The sharing policy is asked right before a CommOp
+    if (job->IsRunning() || job->GetCurrentOpIdx() >= job->CommOpGroups[job->GetCurrentGroupIdx()].CommOps.size())
+        return;
+    if (HasTreeContention(*job))
+        return;
+    // Without other jobs in the group or contention, the sharing policy decides the same for all CommOps
+    auto scheduleRes = m_SharingPolicy(group, *job, now);
+    if (scheduleRes.InsertWaitingTime || scheduleRes.MessageSize != -1ull)
+        return;
+    job->StartFastForward(now, {scheduleRes.UseSharp}, m_MaxSimulationTime, false);
+}
+
+std::size_t AllocationController::StateHash::operator()(const std::vector<long long> &state) const {
+    std::size_t hash = 0;
+    for (auto value : state)
+        hash ^= std::hash<long long>()(value) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+void AllocationController::DetectPeriod(const SharingGroup &group, const Job &job, double now) {
+    if (!IsFastForwardAllowed())
+        return;
+    auto jobs = group.GetJobs();
+    std::sort(jobs.begin(), jobs.end(), [](const Job *job1, const Job *job2) { return job1->ID < job2->ID; });
+    auto &detector = m_PeriodDetectors[&group];
+    assert(!detector.IsExtrapolating);
+    if (detector.Transmissions.size() >= PERIOD_DETECTION_WINDOW * jobs.size())
+        detector = PeriodDetector();
+    // The joint state with the times relative to now, compared by their bit patterns. A sub-nanosecond difference
+    // may still flip a decision of the sharing policy, so the state must repeat exactly.
+    std::vector<long long> state{job.ID};
+    auto combine = [&state](long long value) { state.push_back(value); };
+    auto combineTime = [&combine, now](double time) {
+        static_assert(sizeof(double) == sizeof(long long));
+        long long bits;
+        double relativeTime = time - now;
+        std::memcpy(&bits, &relativeTime, sizeof(bits));
+        combine(bits);
+    };
+    for (auto j : jobs) {
+        combine(j->ID);
+        combine(j->IsStarted());
+        if (!j->IsStarted())
+            continue;
+        combine(j->GetCurrentGroupIdx());
+        combine(j->GetCurrentOpIdx());
+        combine(j->GetCurrentOpTransmittedMessageSize());
+        combine(j->IsRunning() ? 1 + j->IsUsingSharp() : 0);
+        combineTime(j->GetCurrentGroupStartTime());
+        combineTime(j->GetNextEvent(now));
     }
-    assert(nearestJob);
-    return {nearestEventTime, nearestJob, nearestSharingGroup};
+    unsigned int idx = detector.Transmissions.size();
+    detector.Transmissions.emplace_back(job.ID, job.IsUsingSharp());
+    auto [iter, inserted] = detector.States.try_emplace(std::move(state), idx, 0);
+    if (inserted)
+        return;
+    auto [lastIdx, lastPeriod] = iter->second;
+    auto period = idx - lastIdx;
+    iter->second = {idx, period};
+    if (period != lastPeriod)
+        return;
+    const auto &transmissions = detector.Transmissions;
+    if (!std::equal(transmissions.cbegin() + lastIdx + 1, transmissions.cend(),
+                    transmissions.cbegin() + lastIdx + 1 - period))
+        return;
+    // Extrapolate the period, the schedules start right after this transmission
+    std::unordered_map<unsigned int, std::vector<bool>> schedules;
+    for (auto i = lastIdx + 1; i <= idx; ++i)
+        schedules[transmissions[i].first].push_back(transmissions[i].second);
+    for (auto j : jobs)
+        if (schedules.count(j->ID) == 0 || !j->CanFastForward(now, m_MaxSimulationTime) ||
+            (j->StepCount && j->GetCurrentStepIdx() + 1 >= *j->StepCount) || HasTreeContention(*j))
+            return;
+    for (auto j : jobs)
+        j->StartFastForward(now, std::move(schedules[j->ID]), m_MaxSimulationTime, true);
+    detector = PeriodDetector();
+    detector.IsExtrapolating = true;
+    for (unsigned int i = 0; i < m_RunningJobs.Size(); ++i)
+        if (m_SharingGroupMemberships[m_RunningJobs.GetItems()[i]->ID].Group == &group)
+            UpdateNextEvent(m_RunningJobs.GetSlotIdx(i), now);
+}
+
+void AllocationController::StopExtrapolation(const SharingGroup &group, double now) {
+    ResetPeriodDetector(&group);
+    for (unsigned int i = 0; i < m_RunningJobs.Size(); ++i)
+        if (m_SharingGroupMemberships[m_RunningJobs.GetItems()[i]->ID].Group == &group)
+            UpdateNextEvent(m_RunningJobs.GetSlotIdx(i), now);
+}
+
+static std::vector<bool> GetUsingSharp(const std::vector<Job *> &jobs) {
+    std::vector<bool> usingSharp;
+    for (auto job : jobs)
+        usingSharp.push_back(job->IsRunning() && job->IsUsingSharp());
+    return usingSharp;
+}
+
+void AllocationController::UpdateFastForwardAllocations(const std::vector<Job *> &jobs,
+                                                        const std::vector<bool> &wereUsingSharp) {
+    // Deallocate first, a job may start using SHARP right after another job in its group stopped
+    auto isUsingSharp = GetUsingSharp(jobs);
+    for (unsigned int i = 0; i < jobs.size(); ++i)
+        if (wereUsingSharp[i] && !isUsingSharp[i])
+            m_Resources.Deallocate(*jobs[i]->GetCurrentAggrTree());
+    for (unsigned int i = 0; i < jobs.size(); ++i)
+        if (!wereUsingSharp[i] && isUsingSharp[i])
+            m_Resources.Allocate(*jobs[i]->GetCurrentAggrTree());
+}
+
+void AllocationController::CatchUpFastForwardingJobs(double now, unsigned int eventOrder) {
+    std::vector<Job *> jobs;
+    for (const auto &job : m_RunningJobs)
+        if (job->IsFastForwarding())
+            jobs.push_back(job.get());
+    auto wereUsingSharp = GetUsingSharp(jobs);
+    for (auto job : jobs)
+        job->FastForward(now, m_SharingGroupMemberships[job->ID].EventOrder < eventOrder);
+    UpdateFastForwardAllocations(jobs, wereUsingSharp);
+}
+
+bool AllocationController::IsTraced(const Job &job) const {
+    const auto &jobIDs = TraceFilter.JobIDs;
+    if (jobIDs.empty() || jobIDs.count(job.ID) > 0)
+        return true;
+    if (!TraceFilter.IncludeSharingGroups)
+        return false;
+    for (auto otherJob : m_SharingGroupMemberships.at(job.ID).Group->GetJobs())
+        if (jobIDs.count(otherJob->ID) > 0)
+            return true;
+    return false;
 }
 
 void AllocationController::ShowProgress(double now, bool last) {
@@ -183,12 +545,14 @@ void AllocationController::ShowProgress(double now, bool last) {
     std::cout << std::flush;
 }
 
-AllocationController::AllocationController(FatTreeResource &&resources, decltype(m_GetNextJob) &&getNextJob,
+AllocationController::AllocationController(SimulationContext &context, FatTreeResource &&resources,
+                                           decltype(m_GetNextJob) &&getNextJob,
                                            HostAllocationPolicy &&hostAllocationPolicy,
-                                           TreeBuildingPolicy &&treeBuildingPolicy, SharingPolicy &&sharingPolicy)
-    : m_GetNextJob(std::move(getNextJob)), m_HostAllocationPolicy(std::move(hostAllocationPolicy)),
+                                           TreeBuildingPolicy &&treeBuildingPolicy, SharingPolicy &&sharingPolicy,
+                                           SchedulingPolicy &&schedulingPolicy)
+    : m_Context(context), m_GetNextJob(std::move(getNextJob)), m_HostAllocationPolicy(std::move(hostAllocationPolicy)),
       m_TreeBuildingPolicy(std::move(treeBuildingPolicy)), m_SharingPolicy(std::move(sharingPolicy)),
-      m_Resources(std::move(resources)), m_NextJob(m_GetNextJob()) {}
+      m_SchedulingPolicy(std::move(schedulingPolicy)), m_Resources(std::move(resources)), m_NextJob(m_GetNextJob()) {}
 
 AllocationController::~AllocationController() {
     if (!RecordTreeConflicts)
@@ -204,23 +568,63 @@ AllocationController::~AllocationController() {
 SimulationResult AllocationController::RunSimulation(std::optional<double> maxSimulationTime, bool showProgress) {
     m_MaxSimulationTime = maxSimulationTime;
     m_LastShowProgressTime = std::nullopt;
+    m_Tracer = RecordTraces ? std::make_unique<Tracer>(TraceOutputFile, TraceFilter) : nullptr;
     SimulationResult result;
     double now = 0.0;
-    RunNewJobs(result);
+    unsigned int lastEventOrder = 0;
+    RunNewJobs(result, now, true);
     if (showProgress)
         ShowProgress(now, false);
-    while (!m_RunningJobs.empty() && (!m_MaxSimulationTime || now <= *m_MaxSimulationTime)) {
-        auto [nextTime, job, sharingGroup] = GetNextEvent(now);
+    while (!m_EventQueue.Empty() && (!m_MaxSimulationTime || now <= *m_MaxSimulationTime)) {
+        auto [nextTime, slotIdx] = GetNextEvent();
         assert(nextTime >= now);
         now = nextTime;
         if (showProgress)
             ShowProgress(now, false);
-        auto jobFinished = sharingGroup->RunNextEvent(now, job);
-        if (jobFinished) {
+        ++result.EventCount;
+        if (slotIdx == m_ArrivalEventIdx) {
+            lastEventOrder = ARRIVAL_EVENT_ORDER;
+            // The cluster must be up to date before admitting the arrived jobs
+            CatchUpFastForwardingJobs(now, ARRIVAL_EVENT_ORDER);
+            RunNewJobs(result, now, false);
+            continue;
+        }
+        auto job = m_RunningJobs[slotIdx].get();
+        auto [group, aggrTreeVersion, eventOrder] = m_SharingGroupMemberships[job->ID];
+        lastEventOrder = eventOrder;
+        bool jobFinished;
+        if (job->IsFastForwarding()) {
+            // The event of a job in an extrapolated group stops the extrapolation, see DetectPeriod
+            auto isExtrapolating = group->GetJobs().size() > 1;
+            auto jobs = isExtrapolating ? group->GetJobs() : std::vector<Job *>{job};
+            auto wereUsingSharp = GetUsingSharp(jobs);
+            jobFinished = group->RunNextEvent(now, job);
+            assert(!isExtrapolating || !jobFinished);
+            if (isExtrapolating)
+                for (auto otherJob : jobs)
+                    if (otherJob != job && otherJob->IsFastForwarding())
+                        otherJob->FastForward(now, m_SharingGroupMemberships[otherJob->ID].EventOrder < eventOrder);
+            UpdateFastForwardAllocations(jobs, wereUsingSharp);
+            if (isExtrapolating)
+                StopExtrapolation(*group, now);
+        } else {
+            auto wasRunning = job->IsRunning();
+            jobFinished = group->RunNextEvent(now, job);
+            if (!jobFinished && group->GetJobs().size() == 1)
+                TryFastForward(*group, job, now);
+            else if (!jobFinished && !wasRunning && job->IsRunning())
+                DetectPeriod(*group, *job, now);
+        }
+        if (!jobFinished)
+            UpdateNextEvent(slotIdx, now);
+        else {
             assert(job->StepCount);
+            CatchUpFastForwardingJobs(now, eventOrder);
             ++result.FinishedJobCount;
             result.TotalJCT += job->GetFinishTime() - job->GetStartTime();
             result.TotalJCTWeighted += (job->GetFinishTime() - job->GetStartTime()) * job->HostCount;
+            result.TotalJCTWithQueueing += job->GetFinishTime() - job->ArrivalTime;
+            result.TotalJCTWithQueueingWeighted += (job->GetFinishTime() - job->ArrivalTime) * job->HostCount;
             result.TotalJCTWithSharp += job->StepDurationWithSharp * *job->StepCount;
             result.TotalJCTWithSharpWeighted += job->StepDurationWithSharp * *job->StepCount * job->HostCount;
             result.TotalJCTWithoutSharp += job->StepDurationWithoutSharp * *job->StepCount;
@@ -232,25 +636,31 @@ SimulationResult AllocationController::RunSimulation(std::optional<double> maxSi
             if (m_Resources.NodeQuota) {
                 const auto &aggrTree = job->GetCurrentAggrTree();
                 if (aggrTree) {
-                    auto occupiedSharpResource = aggrTree->Nodes.size() - job->HostCount;
+                    auto occupiedSharpResource = aggrTree->NodeIDs.size() - job->HostCount;
                     result.TotalSharpUsage += job->GetDurationWithSharp() * occupiedSharpResource;
                 }
             }
             m_Resources.Deallocate(job->GetHosts());
-            for (auto iter = m_RunningJobs.cbegin(); iter != m_RunningJobs.cend(); ++iter)
-                if (iter->get() == job) {
-                    m_RunningJobs.erase(iter);
-                    break;
-                }
-            RunNewJobs(result);
+            RemoveFromSharingGroup(job);
+            m_EventQueue.Remove(slotIdx);
+            m_RunningJobs.Remove(slotIdx);
+            RunNewJobs(result, now, true);
         }
-        ++result.EventCount;
     }
     if (showProgress)
         ShowProgress(now, true);
-    for (const auto &job : m_RunningJobs) {
+    CatchUpFastForwardingJobs(now, lastEventOrder);
+    // Sum up in the order of job IDs, so the result does not depend on the order in m_RunningJobs
+    std::vector<const Job *> runningJobs;
+    for (const auto &job : m_RunningJobs)
+        runningJobs.push_back(job.get());
+    std::sort(runningJobs.begin(), runningJobs.end(),
+              [](const Job *job1, const Job *job2) { return job1->ID < job2->ID; });
+    for (auto job : runningJobs) {
         result.TotalJCT += job->GetCurrentGroupStartTime() - job->GetStartTime();
         result.TotalJCTWeighted += (job->GetCurrentGroupStartTime() - job->GetStartTime()) * job->HostCount;
+        result.TotalJCTWithQueueing += job->GetCurrentGroupStartTime() - job->ArrivalTime;
+        result.TotalJCTWithQueueingWeighted += (job->GetCurrentGroupStartTime() - job->ArrivalTime) * job->HostCount;
         result.TotalJCTWithSharp += job->StepDurationWithSharp * job->GetCurrentStepIdx();
         result.TotalJCTWithSharpWeighted += job->StepDurationWithSharp * job->GetCurrentStepIdx() * job->HostCount;
         result.TotalJCTWithoutSharp += job->StepDurationWithoutSharp * job->GetCurrentStepIdx();
@@ -262,12 +672,22 @@ SimulationResult AllocationController::RunSimulation(std::optional<double> maxSi
         if (m_Resources.NodeQuota) {
             const auto &aggrTree = job->GetCurrentAggrTree();
             if (aggrTree) {
-                auto occupiedSharpResource = aggrTree->Nodes.size() - job->HostCount;
+                auto occupiedSharpResource = aggrTree->NodeIDs.size() - job->HostCount;
                 result.TotalSharpUsage += job->GetDurationWithSharp() * occupiedSharpResource;
             }
         }
     }
+    // Jobs still pending have waited until the end, leaving them out would bias overloaded runs low
+    for (const auto &[jobID, job] : m_PendingJobs.GetJobs()) {
+        auto queueingDelay = now - job->ArrivalTime;
+        result.TotalQueueingDelay += queueingDelay;
+        result.MaxQueueingDelay = std::max(result.MaxQueueingDelay, queueingDelay);
+        result.TotalJCTWithQueueing += queueingDelay;
+        result.TotalJCTWithQueueingWeighted += queueingDelay * job->HostCount;
+    }
     result.SimulatedTime = now;
+    result.StartedJobCount = m_AllocatedJobCount;
+    result.PendingJobCount = m_PendingJobs.Size();
     result.ClusterUtilization = result.TotalJCTWeighted / (now * m_Resources.Topology->NodesByLayer[0].size());
     result.ConsensusFrequency /= result.TotalJCT;
     if (m_Resources.NodeQuota) {
@@ -275,11 +695,17 @@ SimulationResult AllocationController::RunSimulation(std::optional<double> maxSi
         auto switchCount = topology.Nodes.size() - topology.NodesByLayer[0].size();
         result.SharpUtilization = result.TotalSharpUsage / (now * switchCount);
     }
+    if (m_Tracer) {
+        for (const auto &job : m_RunningJobs)
+            m_Tracer->EndOpenEvents(now, *job);
+        m_Tracer->Close();
+    }
     return result;
 }
 
 SimulationResult
-AllocationController::SimulateSharingGroup(const std::vector<std::pair<unsigned int, std::string_view>> &jobInfos,
+AllocationController::SimulateSharingGroup(SimulationContext &context,
+                                           const std::vector<std::pair<unsigned int, std::string_view>> &jobInfos,
                                            SharingPolicy &&sharingPolicy, unsigned int stepCount) {
     // Count the total number of hosts
     unsigned int totalHostCount = 0;
@@ -290,7 +716,7 @@ AllocationController::SimulateSharingGroup(const std::vector<std::pair<unsigned
     double maxStepDuration = 0.0;
     jobs.reserve(jobInfos.size());
     for (const auto &[hostCount, modelName] : jobInfos) {
-        auto job = std::make_unique<Job>(modelName, hostCount, std::nullopt);
+        auto job = std::make_unique<Job>(context, modelName, hostCount, std::nullopt);
         maxStepDuration = std::max(maxStepDuration, job->StepDurationWithoutSharp);
         jobs.push_back(std::move(job));
     }
@@ -305,8 +731,9 @@ AllocationController::SimulateSharingGroup(const std::vector<std::pair<unsigned
     FatTreeResource resources(topology, 1, std::nullopt);
     FirstHostAllocationPolicy hostAllocationPolicy;
     FirstTreeBuildingPolicy treeBuildingPolicy(false);
-    AllocationController controller(std::move(resources), std::move(getNextJob), std::move(hostAllocationPolicy),
-                                    std::move(treeBuildingPolicy), std::move(sharingPolicy));
+    AllocationController controller(context, std::move(resources), std::move(getNextJob),
+                                    std::move(hostAllocationPolicy), std::move(treeBuildingPolicy),
+                                    std::move(sharingPolicy));
     // Simulate
     return controller.RunSimulation(stepCount * maxStepDuration, false);
 }
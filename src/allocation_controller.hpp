@@ -2,19 +2,30 @@
 
 #include "fat_tree_resource.hpp"
 #include "job.hpp"
+#include "pending_job_queue.hpp"
+#include "scheduling_policies/fifo.hpp"
 #include "sharing_group.hpp"
+#include "simulation_context.hpp"
+#include "utils/indexed_priority_queue.hpp"
+#include "utils/slot_map.hpp"
+#include "utils/trace.hpp"
 #include <chrono>
 #include <functional>
 #include <iostream>
 #include <memory>
 #include <nlohmann/json.hpp>
 #include <optional>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 struct SimulationResult {
     // The number of finished jobs
     unsigned int FinishedJobCount = 0;
+    // The number of jobs allocated with hosts
+    unsigned int StartedJobCount = 0;
+    // The number of arrived jobs still waiting for hosts when the simulation ends
+    unsigned int PendingJobCount = 0;
     // Total simulation time, in second
     double SimulatedTime = 0.0;
     // Simulated event count;
@@ -43,6 +54,15 @@ struct SimulationResult {
     // The sum of the time of all switches that SHARP is enabled, in second
     double TotalSharpUsage = 0.0;
 
+    // The sum of the time from arrival to start of all arrived jobs, in second. Jobs still pending count until the end.
+    double TotalQueueingDelay = 0.0;
+    // The longest time from arrival to start of all arrived jobs, in second. Jobs still pending count until the end.
+    double MaxQueueingDelay = 0.0;
+    // The sum of JCT of all jobs including the time waiting for hosts, in second
+    double TotalJCTWithQueueing = 0.0;
+    // The weighted sum of JCT of all jobs including the time waiting for hosts, in second
+    double TotalJCTWithQueueingWeighted = 0.0;
+
     // The profiled time spent on host allocation, in millisecond (wall clock)
     double TimeCostHostAllocation = 0.0;
     // The profiled time spent on tree building, in millisecond (wall clock)
@@ -69,6 +89,12 @@ struct SimulationResult {
     // Weighted INA utilization rate, see paper for details
     double SharpRatioWeighted() const { return TotalSharpTimeWeighted / TotalJCTWeighted; }
 
+    // 0 if no job has arrived
+    double MeanQueueingDelay() const {
+        auto arrivedJobCount = StartedJobCount + PendingJobCount;
+        return arrivedJobCount == 0 ? 0.0 : TotalQueueingDelay / arrivedJobCount;
+    }
+
     friend void to_json(nlohmann::json &json, const SimulationResult &result);
     friend std::ostream &operator<<(std::ostream &os, const SimulationResult &result);
 };
@@ -80,49 +106,157 @@ public:
     using TreeBuildingPolicy = std::function<void(const FatTreeResource &, const std::vector<std::unique_ptr<Job>> &,
                                                   const std::vector<Job *> &)>;
     using SharingPolicy = std::function<CommOpScheduleResult(const SharingGroup &, const Job &, double)>;
+    using SchedulingPolicy = std::function<void(const FatTreeResource &, const std::vector<std::unique_ptr<Job>> &,
+                                                const PendingJobQueue &, double,
+                                                const std::function<bool(const Job &)> &)>;
 
 private:
-    // Returns the next job if exists, nullptr if not.
+    // All jobs must be created with this context
+    SimulationContext &m_Context;
+    // Returns the next job if exists, nullptr if not. Jobs must be returned in the order of their arrival times.
     std::function<std::unique_ptr<Job>()> m_GetNextJob;
     // Given the resources and the number of required hosts, returns a vector of hosts if there are enough available
     // hosts, std::nullopt if not.
     HostAllocationPolicy m_HostAllocationPolicy;
     // Given the resources, all the running jobs, and the new jobs, build the aggregation tree of each job. This
-    // function should set the aggregation trees by calling Job::SetNextAggrTree.
+    // function should set the aggregation trees by calling Job::SetNextAggrTree. The next aggregation trees of the
+    // running jobs are registered in the resources, identified by job ID.
     TreeBuildingPolicy m_TreeBuildingPolicy;
     // Given the sharing group, the job, and the current time, returns CommOpScheduleResult.
     SharingPolicy m_SharingPolicy;
+    // Given the resources, the running jobs, the pending jobs, the current time, and a function that tries to admit a
+    // pending job with the host allocation policy, admits the pending jobs in any order. The function returns whether
+    // the job is admitted, after which the job is taken out of the pending jobs, see PendingJobQueue.
+    SchedulingPolicy m_SchedulingPolicy;
 
     FatTreeResource m_Resources;
-    std::vector<std::unique_ptr<Job>> m_RunningJobs;
-    std::vector<std::unique_ptr<SharingGroup>> m_SharingGroups;
+    // Addressed by slot index, the jobs themselves are never moved
+    SlotMap<std::unique_ptr<Job>> m_RunningJobs;
+    // The next job to arrive, nullptr if there is none
     std::unique_ptr<Job> m_NextJob;
+    PendingJobQueue m_PendingJobs;
     unsigned int m_AllocatedJobCount = 0;
 
+    struct SharingGroupMembership {
+        SharingGroup *Group;
+        // The version of the next aggregation tree of the job when it joined the group
+        unsigned int AggrTreeVersion;
+        // The position of the job among simultaneous events, see UpdateEventOrders
+        unsigned int EventOrder;
+    };
+    // The sharing groups are the connected components of the tree conflict graph of all running jobs, and are
+    // maintained incrementally as jobs arrive, leave, or change their aggregation trees. Conflicts are found with the
+    // trees registered in m_Resources.
+    std::unordered_map<const SharingGroup *, std::unique_ptr<SharingGroup>> m_SharingGroups;
+    // Job ID -> sharing group of the job
+    std::unordered_map<unsigned int, SharingGroupMembership> m_SharingGroupMemberships;
+
+    // (next event time, event order of the job), see UpdateEventOrders
+    using EventKey = std::pair<double, unsigned int>;
+    // Indexed by the slot index of the job in m_RunningJobs, rebuilt whenever the running jobs change. The arrival of
+    // m_NextJob is an event as well, indexed by m_ArrivalEventIdx.
+    IndexedPriorityQueue<EventKey> m_EventQueue;
+    // One past the slots of m_RunningJobs, which only change when the event queue is rebuilt
+    unsigned int m_ArrivalEventIdx = 0;
+
+    // Running jobs that keep using their current aggregation trees until their transmissions end, collected after
+    // tree building. Only these may contend for SHARP resources with jobs in other sharing groups.
+    std::vector<Job *> m_MigratingJobs;
+
+    // Detects when the joint state of a sharing group repeats modulo a time shift, see DetectPeriod
+    struct StateHash {
+        std::size_t operator()(const std::vector<long long> &state) const;
+    };
+    struct PeriodDetector {
+        // (job ID, whether to use SHARP) of each transmission started in the group
+        std::vector<std::pair<unsigned int, bool>> Transmissions;
+        // Joint state after a transmission started -> (index in Transmissions, the number of transmissions since the
+        // state was seen before, 0 if not). The states are compared in full, a hash collision is no period.
+        std::unordered_map<std::vector<long long>, std::pair<unsigned int, unsigned int>, StateHash> States;
+        // Whether all jobs in the group are fast-forwarding with the schedules of the period
+        bool IsExtrapolating = false;
+    };
+    // Reset whenever the jobs in the group change
+    std::unordered_map<const SharingGroup *, PeriodDetector> m_PeriodDetectors;
+
     std::optional<double> m_MaxSimulationTime; // In second
     std::optional<std::chrono::high_resolution_clock::time_point> m_LastShowProgressTime;
 
+    // Only created if RecordTraces
+    std::unique_ptr<Tracer> m_Tracer;
     std::unordered_map<unsigned int, std::pair<unsigned int, unsigned int>> m_HostFragmentTrace;
     std::vector<bool> m_TreeConflictTrace;
 
-    void BuildSharingGroups();
-    void RunNewJobs(SimulationResult &result);
-    // Returns the time of the next event, the job that will run next, and the sharing group of that job.
-    std::tuple<double, Job *, SharingGroup *> GetNextEvent(double now);
+    SharingGroup *CreateSharingGroup(std::vector<Job *> &&jobs);
+    // Must be called before the jobs in the group change, stops the extrapolation if any.
+    void ResetPeriodDetector(const SharingGroup *group);
+    // Merge the smaller group into the larger one, returns the merged group.
+    SharingGroup *MergeSharingGroups(SharingGroup *group1, SharingGroup *group2);
+    // Split the group into its connected components, the first component stays in the group.
+    void SplitSharingGroup(SharingGroup *group);
+    void RemoveFromSharingGroup(Job *job);
+    // Update the sharing groups of the new jobs and the jobs whose aggregation trees have changed.
+    void UpdateSharingGroups(const std::vector<Job *> &newJobs);
+    // Simultaneous events run in the order the sharing groups were created in when they were rebuilt from scratch
+    // whenever the running jobs changed, so that the results stay the same. The groups were the components of a
+    // union-find over the running jobs in the order of their IDs (the order of admission with FIFO), joined pair by
+    // pair, listed in the order of std::unordered_map, each with its jobs in the order of their IDs. Only this order
+    // is computed again, the groups themselves are kept.
+    void UpdateEventOrders();
+    void RebuildEventQueue(double now);
+    void UpdateArrivalEvent();
+    // Move the jobs arrived by now to the pending queue.
+    void ReceiveArrivedJobs(double now);
+    // Admit the pending jobs with the scheduling policy, then build the aggregation trees. Nothing else is done if no
+    // job is admitted and the running jobs have not changed.
+    void RunNewJobs(SimulationResult &result, double now, bool runningJobsChanged);
+    // Returns the time of the next event and the slot index in m_RunningJobs of the job that will run next, or
+    // m_ArrivalEventIdx if the next job arrives.
+    std::pair<double, unsigned int> GetNextEvent() const;
+    // Re-key the job after it has run an event. The next event time of a job only depends on its own state, so no
+    // other job needs to be re-keyed.
+    void UpdateNextEvent(unsigned int slotIdx, double now);
+    // Returns whether the current aggregation tree of the job conflicts with one that is being migrated from.
+    bool HasTreeContention(const Job &job);
+    // Fast-forwarding skips the callbacks, and needs the sharing groups to be the only source of contention.
+    bool IsFastForwardAllowed() const;
+    // Start fast-forwarding the job if it is alone in its sharing group without contention, see Job::StartFastForward.
+    void TryFastForward(const SharingGroup &group, Job *job, double now);
+    // Called after the job started a transmission. Once the exact joint state of the group is seen three times at equal
+    // distances with the same transmissions in between, the schedule is periodic, and all jobs in the group are
+    // fast-forwarded with their schedules of the period until the jobs in the group change or one of them begins its
+    // last step.
+    void DetectPeriod(const SharingGroup &group, const Job &job, double now);
+    // Must be called once all jobs in the group are up to date.
+    void StopExtrapolation(const SharingGroup &group, double now);
+    // Keep the aggregation trees of the fast-forwarded jobs allocated while they transmit with SHARP.
+    void UpdateFastForwardAllocations(const std::vector<Job *> &jobs, const std::vector<bool> &wereUsingSharp);
+    // Bring all fast-forwarding jobs up to date before the event (now, eventOrder), so the cluster can be inspected.
+    void CatchUpFastForwardingJobs(double now, unsigned int eventOrder);
+    // Returns whether the job passes the job filter of TraceFilter.
+    bool IsTraced(const Job &job) const;
     void ShowProgress(double now, bool last);
 
 public:
     bool RecordTreeConflicts = false;
+    // Each simulation has its own tracer, so simulations running in parallel can record their traces
+    bool RecordTraces = false;
+    // The binary trace file, see Tracer::ConvertToChromeTrace
+    std::string TraceOutputFile = "results/trace.bin";
+    Tracer::Filter TraceFilter;
+    bool EnableFastForward = true;
     std::optional<unsigned int> RecordClusterState = std::nullopt;
     std::string ClusterStateOutputFile;
 
-    explicit AllocationController(FatTreeResource &&resources, decltype(m_GetNextJob) &&getNextJob,
-                                  HostAllocationPolicy &&hostAllocationPolicy, TreeBuildingPolicy &&treeBuildingPolicy,
-                                  SharingPolicy &&sharingPolicy);
+    explicit AllocationController(SimulationContext &context, FatTreeResource &&resources,
+                                  decltype(m_GetNextJob) &&getNextJob, HostAllocationPolicy &&hostAllocationPolicy,
+                                  TreeBuildingPolicy &&treeBuildingPolicy, SharingPolicy &&sharingPolicy,
+                                  SchedulingPolicy &&schedulingPolicy = FIFOSchedulingPolicy());
     ~AllocationController();
 
     SimulationResult RunSimulation(std::optional<double> maxSimulationTime, bool showProgress);
 
-    static SimulationResult SimulateSharingGroup(const std::vector<std::pair<unsigned int, std::string_view>> &jobInfos,
+    static SimulationResult SimulateSharingGroup(SimulationContext &context,
+                                                 const std::vector<std::pair<unsigned int, std::string_view>> &jobInfos,
                                                  SharingPolicy &&sharingPolicy, unsigned int stepCount);
 };
@@ -10,20 +10,26 @@ double DurationCaculator::operator()(CommOp::Type opType, unsigned long long mes
     return Latency + messageSize / bandwidth;
 }
 
-std::vector<CommOpGroup> ModelInfoProvider::GetModelInfo(std::string_view modelName) {
-    std::scoped_lock lock(m_CacheMtx);
-    if (m_ModelInfoCache.count(modelName) == 0) {
-        std::ifstream file(std::string{modelName});
-        m_ModelInfoCache[modelName] = nlohmann::json::parse(file);
-    }
-    const auto &modelInfo = m_ModelInfoCache[modelName];
-    std::vector<CommOpGroup> result(1);
-    auto &opGroup = result.front();
-    opGroup.SyncTime = modelInfo["duration"].get<double>() / GPUSpeedupRatio;
-    for (const auto &op : modelInfo["allreduces"]) {
-        double start = op["start"].get<double>() / GPUSpeedupRatio;
-        unsigned long long size = op["size"];
-        opGroup.CommOps.emplace_back(start, size, CommOp::Type::AllReduce);
-    }
-    return result;
+std::size_t ModelInfoProvider::KeyHash::operator()(const std::pair<std::string_view, double> &key) const {
+    return std::hash<std::string_view>()(key.first) * 31 + std::hash<double>()(key.second);
+}
+
+const ModelInfo &ModelInfoProvider::GetModelInfo(std::string_view modelName, double gpuSpeedupRatio) {
+    std::pair key(modelName, gpuSpeedupRatio);
+    return *m_Models.GetOrCreate(key, [&] {
+        std::string_view name = *m_ModelNames.emplace(modelName).first;
+        std::ifstream file(std::string{name});
+        auto modelInfo = nlohmann::json::parse(file);
+        std::vector<CommOpGroup> commOpGroups(1);
+        auto &opGroup = commOpGroups.front();
+        opGroup.SyncTime = modelInfo["duration"].get<double>() / gpuSpeedupRatio;
+        for (const auto &op : modelInfo["allreduces"]) {
+            double start = op["start"].get<double>() / gpuSpeedupRatio;
+            unsigned long long size = op["size"];
+            opGroup.CommOps.emplace_back(start, size, CommOp::Type::AllReduce);
+        }
+        auto id = static_cast<unsigned int>(m_Models.Size());
+        return std::pair(std::pair(name, gpuSpeedupRatio),
+                         std::unique_ptr<const ModelInfo>(new ModelInfo{id, name, std::move(commOpGroups)}));
+    });
 }
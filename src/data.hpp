@@ -1,10 +1,13 @@
 #pragma once
 
 #include "job.hpp"
-#include <mutex>
-#include <nlohmann/json.hpp>
-#include <unordered_map>
-#include <vector>
+#include "utils/read_mostly_map.hpp"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
 
 class DurationCaculator {
 public:
@@ -20,11 +23,18 @@ public:
 
 class ModelInfoProvider {
 private:
-    inline static std::mutex m_CacheMtx;
-    inline static std::unordered_map<std::string_view, nlohmann::json> m_ModelInfoCache;
+    struct KeyHash {
+        std::size_t operator()(const std::pair<std::string_view, double> &key) const;
+    };
 
-public:
-    inline static double GPUSpeedupRatio = 1.0;
+    // Copies of the model names viewed by the keys and ModelInfo::Name, only touched while m_Models adds a model
+    inline static std::unordered_set<std::string> m_ModelNames;
+    // (model name, GPU speedup ratio) -> model, never removed so that the references stay valid
+    inline static ReadMostlyMap<std::pair<std::string_view, double>, std::unique_ptr<const ModelInfo>, KeyHash>
+        m_Models;
 
-    static std::vector<CommOpGroup> GetModelInfo(std::string_view modelName);
+public:
+    // The computation time of the model is divided by gpuSpeedupRatio. Each model is parsed once for each GPU speedup
+    // ratio, and later lookups take no lock. The name is copied, so it only needs to outlive the call.
+    static const ModelInfo &GetModelInfo(std::string_view modelName, double gpuSpeedupRatio);
 };
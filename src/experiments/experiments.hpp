@@ -5,6 +5,9 @@
 #include "host_allocation_policies/first.hpp"
 #include "host_allocation_policies/random.hpp"
 #include "host_allocation_policies/smart.hpp"
+#include "scheduling_policies/easy_backfilling.hpp"
+#include "scheduling_policies/fifo.hpp"
+#include "scheduling_policies/shortest_job_first.hpp"
 #include "sharing_policies/greedy.hpp"
 #include "sharing_policies/non_sharp.hpp"
 #include "sharing_policies/smart.hpp"
@@ -14,7 +17,9 @@
 #include "utils/graph.hpp"
 #include "utils/parallel.hpp"
 #include "utils/trace.hpp"
+#include "workload.hpp"
 #include <array>
+#include <cassert>
 #include <cmath>
 #include <fstream>
 #include <functional>
@@ -45,6 +50,8 @@ inline static std::vector<std::string> ModelListBs16 = {
 };
 inline static const auto &ModelList = ModelListBs4;
 
+inline static const std::vector<unsigned int> StepCountList = {10, 20, 30, 40, 50, 60, 70, 80, 90, 100};
+
 inline static std::vector<std::vector<std::pair<unsigned int, unsigned int>>> HostCountTraces = {
     {{1, 10910}, {2, 9719}, {4, 16374}, {8, 23311}, {16, 23936}, {32, 13268}, {48, 2089}, {64, 329}, {128, 61}},
     {{1, 26464}, {2, 19460}, {4, 24834}, {8, 20690}, {16, 7818}, {32, 725}, {48, 5}},
@@ -58,6 +65,19 @@ inline static std::vector<std::vector<std::pair<unsigned int, unsigned int>>> Ho
     {{8, 26464}, {16, 67247}, {32, 6241}, {48, 45}},
 };
 
+// Returns a generator of jobCount jobs with random models, # of hosts drawn from the host count trace, and random step
+// counts. Every generator created with the same arguments yields the same jobs. All jobs arrive at time 0, or as a
+// Poisson process with arrivalRate in jobs per second if given, which leaves the other draws unchanged.
+std::function<std::unique_ptr<Job>()> CreateJobGenerator(SimulationContext &context, unsigned int hostCountTraceIdx,
+                                                         unsigned int jobCount,
+                                                         std::optional<double> arrivalRate = std::nullopt);
+// The same as CreateJobGenerator, but draws the jobs in batches with SyntheticWorkload, whose alias tables are built
+// once. The alias method maps random numbers to host counts differently, so the host counts differ from those of
+// CreateJobGenerator.
+std::function<std::unique_ptr<Job>()> CreateSyntheticJobGenerator(SimulationContext &context,
+                                                                  unsigned int hostCountTraceIdx, unsigned int jobCount,
+                                                                  std::optional<double> arrivalRate = std::nullopt);
+
 void TestTreeConflicts();
 void TestAccelerateEffectiveness();
 void OutputTraces();
@@ -68,3 +88,9 @@ void TestTreeBuilding();
 void TestSharing();
 void TestSharingOverhead();
 void RecordClusterState();
+// Simulate every point of the parameter grid in the config file, see README. Returns false if the config is invalid.
+bool RunSweep(const std::string &configFileName);
+// Simulate the points claimed from the work queue in the directory, shared by the workers on all nodes.
+bool RunSweepWorker(const std::string &configFileName, const std::string &queueDir);
+// Merge the results in the work queue into the output file of the sweep.
+bool ReduceSweep(const std::string &configFileName, const std::string &queueDir);
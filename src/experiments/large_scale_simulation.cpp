@@ -1,47 +1,29 @@
 #include "experiments.hpp"
 
 static SimulationResult Simulate(bool enableMina, unsigned int hostTraceId) {
-    std::vector<unsigned int> hostCountList, weightList;
-    for (auto [hostCount, weight] : HostCountTraces[hostTraceId]) {
-        hostCountList.push_back(hostCount);
-        weightList.push_back(weight);
-    }
+    SimulationContext context(DurationCaculator(12'500'000'000, 2.0, 0.000'05));
     FatTree topology(16);
     FatTreeResource resources(topology, 1, std::nullopt);
-    auto getNextJob = [hostCountList, weightList, jobCount = 0u]() mutable -> std::unique_ptr<Job> {
-        if (jobCount >= 1000)
-            return nullptr;
-        ++jobCount;
-        thread_local std::default_random_engine engine(42);
-        thread_local std::vector<unsigned int> stepCountList = {10, 20, 30, 40, 50, 60, 70, 80, 90, 100};
-        std::uniform_int_distribution<std::size_t> randomModel(0, ModelList.size() - 1);
-        std::discrete_distribution<std::size_t> randomHostCount(weightList.cbegin(), weightList.cend());
-        std::uniform_int_distribution<std::size_t> randomStepCount(0, stepCountList.size() - 1);
-        std::string_view model = ModelList[randomModel(engine)];
-        auto hostCount = hostCountList[randomHostCount(engine)];
-        auto stepCount = stepCountList[randomStepCount(engine)];
-        return std::make_unique<Job>(model, hostCount, stepCount);
-    };
+    auto getNextJob = CreateJobGenerator(context, hostTraceId, 1000);
     AllocationController::HostAllocationPolicy hostAllocationPolicy;
     AllocationController::TreeBuildingPolicy treeBuildingPolicy;
     AllocationController::SharingPolicy sharingPolicy;
     if (enableMina) {
         hostAllocationPolicy = SmartHostAllocationPolicy(0.5);
-        treeBuildingPolicy = SmartTreeBuildingPolicy(5);
+        treeBuildingPolicy = SmartTreeBuildingPolicy(context, 5);
         sharingPolicy = SmartSharingPolicy();
     } else {
         hostAllocationPolicy = FirstHostAllocationPolicy();
         treeBuildingPolicy = FirstTreeBuildingPolicy(true);
         sharingPolicy = GreedySharingPolicy();
     }
-    AllocationController controller(std::move(resources), std::move(getNextJob), std::move(hostAllocationPolicy),
-                                    std::move(treeBuildingPolicy), std::move(sharingPolicy));
+    AllocationController controller(context, std::move(resources), std::move(getNextJob),
+                                    std::move(hostAllocationPolicy), std::move(treeBuildingPolicy),
+                                    std::move(sharingPolicy));
     return controller.RunSimulation(std::nullopt, true);
 }
 
 void TestLargeScaleSimulation() {
-    Job::CalcTransmissionDuration = DurationCaculator(12'500'000'000, 2.0, 0.000'05);
-    ModelInfoProvider::GPUSpeedupRatio = 1.0;
     auto results = Parallel::Run<SimulationResult>( //
         [] { return Simulate(true, 0); },           //
         [] { return Simulate(false, 0); },          //
@@ -2,10 +2,18 @@
 
 static constexpr unsigned int StepCount = 100;
 
+// This is different than default settings
+static std::unique_ptr<SimulationContext> CreateContext() {
+    auto context = std::make_unique<SimulationContext>(DurationCaculator(12'500'000'000, 1.5, 0.000'05));
+    context->GPUSpeedupRatio = 1.5;
+    return context;
+}
+
+static void ShowProgress(unsigned int, unsigned int finishedCount, unsigned int count) {
+    std::cout << "Simulation #" << finishedCount << " of " << count << " finished\n";
+}
+
 void TestSharing() {
-    // This is different than default settings
-    Job::CalcTransmissionDuration = DurationCaculator(12'500'000'000, 1.5, 0.000'05);
-    ModelInfoProvider::GPUSpeedupRatio = 1.5;
     unsigned int modelCount = ModelList.size();
 
     auto res2Jobs = Parallel::RunRanks<double>(
@@ -14,11 +22,11 @@ void TestSharing() {
                 {2, ModelList[rank / modelCount]}, //
                 {2, ModelList[rank % modelCount]}, //
             };
-            auto result = AllocationController::SimulateSharingGroup(jobList, SmartSharingPolicy(), StepCount);
-            std::cout << "Simulation #" << rank + 1 << " of " << modelCount * modelCount << "finished\n";
+            auto result = AllocationController::SimulateSharingGroup(*CreateContext(), jobList, SmartSharingPolicy(),
+                                                                     StepCount);
             return result.JCTScoreWeighted();
         },
-        modelCount * modelCount);
+        modelCount * modelCount, ShowProgress);
 
     auto res3Jobs = Parallel::RunRanks<double>(
         [modelCount](unsigned int rank) {
@@ -27,11 +35,11 @@ void TestSharing() {
                 {2, ModelList[(rank / modelCount) % modelCount]}, //
                 {2, ModelList[rank % modelCount]},                //
             };
-            auto result = AllocationController::SimulateSharingGroup(jobList, SmartSharingPolicy(), StepCount);
-            std::cout << "Simulation #" << rank + 1 << " of " << modelCount * modelCount * modelCount << "finished\n";
+            auto result = AllocationController::SimulateSharingGroup(*CreateContext(), jobList, SmartSharingPolicy(),
+                                                                     StepCount);
             return result.JCTScoreWeighted();
         },
-        modelCount * modelCount * modelCount);
+        modelCount * modelCount * modelCount, ShowProgress);
 
     auto res4Jobs = Parallel::RunRanks<double>(
         [modelCount](unsigned int rank) {
@@ -41,12 +49,11 @@ void TestSharing() {
                 {2, ModelList[(rank / modelCount) % modelCount]},                //
                 {2, ModelList[rank % modelCount]},                               //
             };
-            auto result = AllocationController::SimulateSharingGroup(jobList, SmartSharingPolicy(), StepCount);
-            std::cout << "Simulation #" << rank + 1 << " of " << modelCount * modelCount * modelCount * modelCount
-                      << "finished\n";
+            auto result = AllocationController::SimulateSharingGroup(*CreateContext(), jobList, SmartSharingPolicy(),
+                                                                     StepCount);
             return result.JCTScoreWeighted();
         },
-        modelCount * modelCount * modelCount * modelCount);
+        modelCount * modelCount * modelCount * modelCount, ShowProgress);
 
     std::ofstream file("results/sharing.json");
     file << nlohmann::json({
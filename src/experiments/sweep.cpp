@@ -0,0 +1,453 @@
+#include "experiments.hpp"
+#include "utils/work_queue.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iterator>
+#include <unordered_map>
+
+static bool IsPositiveInteger(const nlohmann::json &value) {
+    return value.is_number_integer() && value.get<long long>() > 0;
+}
+
+static bool IsPositiveNumber(const nlohmann::json &value) { return value.is_number() && value.get<double>() > 0.0; }
+
+static bool IsLinkCounts(const nlohmann::json &value) {
+    return value.is_array() && value.size() == FatTree::Height &&
+           std::all_of(value.cbegin(), value.cend(), IsPositiveInteger);
+}
+
+// A topology is either the degree of a fat tree, or {"down_link_count": [...], "up_link_count": [...]}
+static bool IsTopology(const nlohmann::json &value) {
+    if (IsPositiveInteger(value))
+        return value.get<unsigned int>() % 2 == 0;
+    return value.is_object() && value.size() == 2 && IsLinkCounts(value.value("down_link_count", nlohmann::json())) &&
+           IsLinkCounts(value.value("up_link_count", nlohmann::json()));
+}
+
+static std::unique_ptr<FatTree> CreateTopology(const nlohmann::json &value) {
+    if (value.is_number())
+        return std::make_unique<FatTree>(value.get<unsigned int>());
+    return std::make_unique<FatTree>(value["down_link_count"].get<std::array<unsigned int, FatTree::Height>>(),
+                                     value["up_link_count"].get<std::array<unsigned int, FatTree::Height>>());
+}
+
+static std::optional<unsigned int> GetOptionalCount(const nlohmann::json &value) {
+    if (value.is_null())
+        return std::nullopt;
+    return value.get<unsigned int>();
+}
+
+static bool IsOneOf(const nlohmann::json &value, std::initializer_list<std::string_view> names) {
+    return value.is_string() && std::find(names.begin(), names.end(), value.get<std::string>()) != names.end();
+}
+
+struct SweepDimension {
+    const char *Name;
+    // Used if the dimension is not in the grid
+    nlohmann::json DefaultValue;
+    bool (*IsValid)(const nlohmann::json &);
+};
+
+// The last dimension varies the fastest in the order of the points
+static const std::vector<SweepDimension> SweepDimensions = {
+    {"topology", 16, IsTopology},
+    {"node_quota", 1, [](const nlohmann::json &value) { return value.is_null() || IsPositiveInteger(value); }},
+    {"link_quota", nullptr, [](const nlohmann::json &value) { return value.is_null() || IsPositiveInteger(value); }},
+    {"host_count_trace", 0,
+     [](const nlohmann::json &value) {
+         return value.is_number_integer() && value.get<long long>() >= 0 &&
+                value.get<unsigned long long>() < HostCountTraces.size();
+     }},
+    // Poisson arrivals in jobs per second, or all jobs arrive at time 0
+    {"arrival_rate", nullptr, [](const nlohmann::json &value) { return value.is_null() || IsPositiveNumber(value); }},
+    // How jobs are drawn from the host count trace, "synthetic" uses SyntheticWorkload and so draws other host counts
+    {"workload", "experiments",
+     [](const nlohmann::json &value) { return IsOneOf(value, {"experiments", "synthetic"}); }},
+    // A CSV file replayed by TraceWorkload instead of the host count trace
+    {"job_trace", nullptr, [](const nlohmann::json &value) { return value.is_null() || value.is_string(); }},
+    {"bandwidth", 12'500'000'000.0, IsPositiveNumber},
+    {"sharp_acc_ratio", 2.0, IsPositiveNumber},
+    {"latency", 0.000'05, [](const nlohmann::json &value) { return value.is_number() && value.get<double>() >= 0.0; }},
+    {"gpu_speedup_ratio", 1.0, IsPositiveNumber},
+    {"host_allocation_policy", "smart",
+     [](const nlohmann::json &value) { return IsOneOf(value, {"first", "random", "smart"}); }},
+    {"tree_building_policy", "smart",
+     [](const nlohmann::json &value) { return IsOneOf(value, {"first", "random", "smart"}); }},
+    // Only used by the smart tree building policy, null for no limit
+    {"max_tree_count", 5, [](const nlohmann::json &value) { return value.is_null() || IsPositiveInteger(value); }},
+    {"sharing_policy", "smart",
+     [](const nlohmann::json &value) { return IsOneOf(value, {"greedy", "non_sharp", "smart"}); }},
+    {"scheduling_policy", "fifo",
+     [](const nlohmann::json &value) { return IsOneOf(value, {"fifo", "easy_backfilling", "sjf"}); }},
+};
+
+// Returns all points of the grid, or std::nullopt if the grid is invalid.
+static std::optional<std::vector<nlohmann::json>> ExpandGrid(const nlohmann::json &grid) {
+    if (!grid.is_object()) {
+        std::cerr << "The grid must be an object!\n";
+        return std::nullopt;
+    }
+    for (const auto &[name, _] : grid.items())
+        if (std::none_of(SweepDimensions.cbegin(), SweepDimensions.cend(),
+                         [&name = name](const SweepDimension &dimension) { return name == dimension.Name; })) {
+            std::cerr << "Unknown sweep dimension \"" << name << "\"!\n";
+            return std::nullopt;
+        }
+    std::vector<nlohmann::json> points = {nlohmann::json::object()};
+    for (const auto &dimension : SweepDimensions) {
+        auto values = grid.value(dimension.Name, nlohmann::json::array({dimension.DefaultValue}));
+        if (!values.is_array() || values.empty()) {
+            std::cerr << "The values of \"" << dimension.Name << "\" must be a non-empty array!\n";
+            return std::nullopt;
+        }
+        for (const auto &value : values)
+            if (!dimension.IsValid(value)) {
+                std::cerr << "Invalid value of \"" << dimension.Name << "\": " << value << '\n';
+                return std::nullopt;
+            }
+        std::vector<nlohmann::json> newPoints;
+        newPoints.reserve(points.size() * values.size());
+        for (const auto &point : points)
+            for (const auto &value : values) {
+                newPoints.push_back(point);
+                newPoints.back()[dimension.Name] = value;
+            }
+        points = std::move(newPoints);
+    }
+    return points;
+}
+
+// Returns std::nullopt if the job trace cannot be read or has an invalid row, which is reported to stderr.
+static std::optional<SimulationResult> SimulatePoint(const nlohmann::json &point, unsigned int jobCount) {
+    SimulationContext context(DurationCaculator(point["bandwidth"].get<double>(),
+                                                point["sharp_acc_ratio"].get<double>(),
+                                                point["latency"].get<double>()));
+    context.GPUSpeedupRatio = point["gpu_speedup_ratio"].get<double>();
+    auto topology = CreateTopology(point["topology"]);
+    FatTreeResource resources(*topology, GetOptionalCount(point["node_quota"]),
+                              GetOptionalCount(point["link_quota"]));
+    std::optional<double> arrivalRate;
+    if (!point["arrival_rate"].is_null())
+        arrivalRate = point["arrival_rate"].get<double>();
+    std::shared_ptr<TraceWorkload> traceWorkload;
+    std::function<std::unique_ptr<Job>()> getNextJob;
+    auto hostCountTraceIdx = point["host_count_trace"].get<unsigned int>();
+    if (!point["job_trace"].is_null()) {
+        traceWorkload = std::make_shared<TraceWorkload>(point["job_trace"].get<std::string>(), jobCount);
+        if (traceWorkload->HasError())
+            return std::nullopt;
+        getNextJob = CreateWorkloadJobGenerator(context, traceWorkload);
+    } else if (point["workload"] == "synthetic")
+        getNextJob = CreateSyntheticJobGenerator(context, hostCountTraceIdx, jobCount, arrivalRate);
+    else
+        getNextJob = CreateJobGenerator(context, hostCountTraceIdx, jobCount, arrivalRate);
+    AllocationController::HostAllocationPolicy hostAllocationPolicy;
+    AllocationController::TreeBuildingPolicy treeBuildingPolicy;
+    AllocationController::SharingPolicy sharingPolicy;
+    AllocationController::SchedulingPolicy schedulingPolicy;
+    auto hostAllocationPolicyName = point["host_allocation_policy"].get<std::string>();
+    if (hostAllocationPolicyName == "first")
+        hostAllocationPolicy = FirstHostAllocationPolicy();
+    else if (hostAllocationPolicyName == "random")
+        hostAllocationPolicy = RandomHostAllocationPolicy();
+    else
+        hostAllocationPolicy = SmartHostAllocationPolicy(0.5);
+    auto treeBuildingPolicyName = point["tree_building_policy"].get<std::string>();
+    if (treeBuildingPolicyName == "first")
+        treeBuildingPolicy = FirstTreeBuildingPolicy(true);
+    else if (treeBuildingPolicyName == "random")
+        treeBuildingPolicy = RandomTreeBuildingPolicy(true);
+    else
+        treeBuildingPolicy = SmartTreeBuildingPolicy(context, GetOptionalCount(point["max_tree_count"]));
+    auto sharingPolicyName = point["sharing_policy"].get<std::string>();
+    if (sharingPolicyName == "greedy")
+        sharingPolicy = GreedySharingPolicy();
+    else if (sharingPolicyName == "non_sharp")
+        sharingPolicy = NonSharpSharingPolicy();
+    else
+        sharingPolicy = SmartSharingPolicy();
+    auto schedulingPolicyName = point["scheduling_policy"].get<std::string>();
+    if (schedulingPolicyName == "fifo")
+        schedulingPolicy = FIFOSchedulingPolicy();
+    else if (schedulingPolicyName == "easy_backfilling")
+        schedulingPolicy = EasyBackfillingSchedulingPolicy();
+    else
+        schedulingPolicy = ShortestJobFirstSchedulingPolicy();
+    AllocationController controller(context, std::move(resources), std::move(getNextJob),
+                                    std::move(hostAllocationPolicy), std::move(treeBuildingPolicy),
+                                    std::move(sharingPolicy), std::move(schedulingPolicy));
+    auto result = controller.RunSimulation(std::nullopt, false);
+    // Reading stops at an invalid row, so the result would be of a truncated trace
+    if (traceWorkload && traceWorkload->HasError())
+        return std::nullopt;
+    return result;
+}
+
+// Returns the records in the output file by their points, the last line may be cut off by an interrupted sweep.
+static std::unordered_map<std::string, std::string> ReadRecords(const std::string &outputFileName) {
+    std::unordered_map<std::string, std::string> records;
+    std::ifstream file(outputFileName);
+    std::string line;
+    while (std::getline(file, line)) {
+        auto record = nlohmann::json::parse(line, nullptr, false);
+        if (!record.is_discarded() && record.is_object() && record.contains("point") && record.contains("result"))
+            records[record["point"].dump()] = std::move(line);
+    }
+    return records;
+}
+
+// Returns whether the file is missing, empty, or ends with a complete line.
+static bool EndsWithNewLine(const std::string &fileName) {
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    if (!file || file.tellg() <= 0)
+        return true;
+    file.seekg(-1, std::ios::end);
+    return file.get() == '\n';
+}
+
+struct SweepConfig {
+    std::string OutputFileName;
+    // Written once all points are finished, in the layout of the results of the experiments
+    std::optional<std::string> ResultsFileName;
+    unsigned int JobCount;
+    // Only used by the workers sharing a queue directory
+    std::chrono::seconds LeaseTimeout;
+    std::vector<nlohmann::json> Points;
+    // (name, # of points) of the named grids, whose points are consecutive. The results file is an object of the
+    // results of each grid if there are named grids, or an array of the results of all points otherwise.
+    std::vector<std::pair<std::string, std::size_t>> NamedGrids;
+};
+
+static std::optional<SweepConfig> LoadSweepConfig(const std::string &configFileName) {
+    std::ifstream configFile(configFileName);
+    if (!configFile) {
+        std::cerr << "Cannot open " << configFileName << "!\n";
+        return std::nullopt;
+    }
+    auto config = nlohmann::json::parse(configFile, nullptr, false);
+    if (config.is_discarded() || !config.is_object()) {
+        std::cerr << "Invalid sweep config!\n";
+        return std::nullopt;
+    }
+    auto outputFileName = config.value("output_file", nlohmann::json("results/sweep.jsonl"));
+    auto jobCount = config.value("job_count", nlohmann::json(1000));
+    auto resultsFileName = config.value("results_file", nlohmann::json());
+    auto leaseTimeout = config.value("lease_timeout", nlohmann::json(600));
+    if (!outputFileName.is_string() || !(resultsFileName.is_null() || resultsFileName.is_string()) ||
+        !IsPositiveInteger(jobCount) || !IsPositiveInteger(leaseTimeout)) {
+        std::cerr << "Invalid output_file, results_file, job_count, or lease_timeout!\n";
+        return std::nullopt;
+    }
+    SweepConfig sweepConfig{outputFileName.get<std::string>(), std::nullopt, jobCount.get<unsigned int>(),
+                            std::chrono::seconds(leaseTimeout.get<unsigned int>()), {}, {}};
+    if (resultsFileName.is_string())
+        sweepConfig.ResultsFileName = resultsFileName.get<std::string>();
+    auto appendGrid = [&sweepConfig](const nlohmann::json &grid) {
+        auto points = ExpandGrid(grid);
+        if (!points)
+            return false;
+        sweepConfig.Points.insert(sweepConfig.Points.end(), points->cbegin(), points->cend());
+        return true;
+    };
+    // A grid, a list of grids whose points are concatenated, or named grids
+    if (config.contains("grids")) {
+        const auto &grids = config["grids"];
+        if (config.contains("grid") || !grids.is_object() || grids.empty()) {
+            std::cerr << "The named grids must be a non-empty object, and cannot be used with \"grid\"!\n";
+            return std::nullopt;
+        }
+        for (const auto &[name, grid] : grids.items()) {
+            auto pointCount = sweepConfig.Points.size();
+            if (!appendGrid(grid))
+                return std::nullopt;
+            sweepConfig.NamedGrids.emplace_back(name, sweepConfig.Points.size() - pointCount);
+        }
+    } else {
+        auto grid = config.value("grid", nlohmann::json::object());
+        if (grid.is_array() && grid.empty()) {
+            std::cerr << "The list of grids must not be empty!\n";
+            return std::nullopt;
+        }
+        for (const auto &subGrid : grid.is_array() ? grid : nlohmann::json::array({grid}))
+            if (!appendGrid(subGrid))
+                return std::nullopt;
+    }
+    return sweepConfig;
+}
+
+// Writes the results of all points to the results file of the sweep if any, once all points are finished.
+static bool WriteResultsFile(const SweepConfig &config, const std::unordered_map<std::string, std::string> &records) {
+    if (!config.ResultsFileName)
+        return true;
+    std::vector<nlohmann::json> results;
+    for (const auto &point : config.Points) {
+        auto iter = records.find(point.dump());
+        if (iter == records.end()) {
+            std::cout << *config.ResultsFileName << " is written once all points are finished\n";
+            return true;
+        }
+        results.push_back(std::move(nlohmann::json::parse(iter->second)["result"]));
+    }
+    nlohmann::json jsonResults;
+    if (config.NamedGrids.empty())
+        jsonResults = std::move(results);
+    else {
+        auto iter = results.begin();
+        for (const auto &[name, pointCount] : config.NamedGrids) {
+            jsonResults[name] = std::vector(std::make_move_iterator(iter), std::make_move_iterator(iter + pointCount));
+            iter += pointCount;
+        }
+    }
+    std::ofstream file(*config.ResultsFileName);
+    if (!file) {
+        std::cerr << "Cannot open " << *config.ResultsFileName << "!\n";
+        return false;
+    }
+    file << jsonResults;
+    std::cout << "Results written to " << *config.ResultsFileName << '\n';
+    return true;
+}
+
+// Returns std::nullopt if the point cannot be simulated, see SimulatePoint.
+static std::optional<std::string> SimulatePointToRecord(const nlohmann::json &point, unsigned int jobCount) {
+    auto result = SimulatePoint(point, jobCount);
+    if (!result) {
+        std::cerr << "Point " << point.dump() << " failed!\n";
+        return std::nullopt;
+    }
+    return nlohmann::json({{"point", point}, {"result", *result}}).dump();
+}
+
+bool RunSweep(const std::string &configFileName) {
+    auto config = LoadSweepConfig(configFileName);
+    if (!config)
+        return false;
+    const auto &outputFileName = config->OutputFileName;
+    const auto &points = config->Points;
+
+    // Each result is appended as soon as it is ready, so an interrupted sweep resumes from the finished points
+    auto finishedPoints = ReadRecords(outputFileName);
+    std::vector<const nlohmann::json *> pendingPoints;
+    for (const auto &point : points)
+        if (finishedPoints.count(point.dump()) == 0)
+            pendingPoints.push_back(&point);
+    std::cout << points.size() << " points, " << points.size() - pendingPoints.size() << " already finished\n";
+    bool endsWithNewLine = EndsWithNewLine(outputFileName);
+    std::ofstream outputFile(outputFileName, std::ios::app);
+    if (!outputFile) {
+        std::cerr << "Cannot open " << outputFileName << "!\n";
+        return false;
+    }
+    if (!endsWithNewLine)
+        outputFile << '\n';
+
+    std::mutex outputMutex;
+    unsigned int finishedCount = 0, failedCount = 0;
+    ThreadPool::GetInstance().RunAll(pendingPoints.size(), [&](unsigned int idx) {
+        const auto &point = *pendingPoints[idx];
+        auto record = SimulatePointToRecord(point, config->JobCount);
+        std::lock_guard lock(outputMutex);
+        // A failed point is not recorded, so that it is retried once fixed
+        if (!record) {
+            ++failedCount;
+            return;
+        }
+        outputFile << *record << '\n' << std::flush;
+        std::cout << "Point " << point.dump() << " finished (" << ++finishedCount << " of " << pendingPoints.size()
+                  << ")\n";
+    });
+    outputFile.close();
+    if (failedCount > 0) {
+        std::cerr << failedCount << " points failed!\n";
+        return false;
+    }
+    return WriteResultsFile(*config, ReadRecords(outputFileName));
+}
+
+bool RunSweepWorker(const std::string &configFileName, const std::string &queueDir) {
+    auto config = LoadSweepConfig(configFileName);
+    if (!config)
+        return false;
+    const auto &points = config->Points;
+    DirectoryWorkQueue queue(queueDir, points.size(), config->LeaseTimeout);
+    // Idle threads wait for the points leased by other workers, which are taken over if the workers die
+    auto pollInterval = std::clamp<std::chrono::milliseconds>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(config->LeaseTimeout) / 4, std::chrono::milliseconds(100),
+        std::chrono::seconds(10));
+    std::mutex outputMutex;
+    unsigned int finishedCount = 0, failedCount = 0;
+    auto &pool = ThreadPool::GetInstance();
+    pool.RunAll(pool.GetThreadCount(), [&](unsigned int) {
+        unsigned int checkedPointCount = 0;
+        while (true) {
+            auto pointIdx = queue.Claim();
+            if (!pointIdx) {
+                while (checkedPointCount < points.size() &&
+                       (queue.IsFinished(checkedPointCount) || queue.IsAbandoned(checkedPointCount)))
+                    ++checkedPointCount;
+                if (checkedPointCount == points.size())
+                    return;
+                std::this_thread::sleep_for(pollInterval);
+                continue;
+            }
+            auto record = SimulatePointToRecord(points[*pointIdx], config->JobCount);
+            if (!record) {
+                queue.Abandon(*pointIdx);
+                std::lock_guard lock(outputMutex);
+                ++failedCount;
+                continue;
+            }
+            queue.Finish(*pointIdx, *record);
+            std::lock_guard lock(outputMutex);
+            std::cout << "Point #" << *pointIdx << " finished (" << ++finishedCount << " by this worker)\n";
+        }
+    });
+    if (failedCount > 0) {
+        std::cerr << failedCount << " points failed!\n";
+        return false;
+    }
+    return true;
+}
+
+bool ReduceSweep(const std::string &configFileName, const std::string &queueDir) {
+    auto config = LoadSweepConfig(configFileName);
+    if (!config)
+        return false;
+    const auto &outputFileName = config->OutputFileName;
+    const auto &points = config->Points;
+    // The points already in the output file, e.g. from a local sweep
+    auto records = ReadRecords(outputFileName);
+    for (unsigned int pointIdx = 0; pointIdx < points.size(); ++pointIdx) {
+        auto result = DirectoryWorkQueue::GetResult(queueDir, pointIdx);
+        if (!result)
+            continue;
+        auto record = nlohmann::json::parse(*result, nullptr, false);
+        if (record.is_discarded() || !record.is_object() ||
+            record.value("point", nlohmann::json()) != points[pointIdx]) {
+            std::cerr << "The result of point #" << pointIdx << " does not match the config!\n";
+            return false;
+        }
+        records[points[pointIdx].dump()] = std::move(*result);
+    }
+    // Written in the order of the grid, and replaced atomically
+    auto tempFileName = outputFileName + ".tmp";
+    {
+        std::ofstream file(tempFileName);
+        if (!file) {
+            std::cerr << "Cannot open " << tempFileName << "!\n";
+            return false;
+        }
+        for (const auto &point : points) {
+            auto iter = records.find(point.dump());
+            if (iter != records.end())
+                file << iter->second << '\n';
+        }
+    }
+    std::filesystem::rename(tempFileName, outputFileName);
+    unsigned int finishedCount = std::count_if(points.cbegin(), points.cend(), [&records](const nlohmann::json &point) {
+        return records.count(point.dump()) > 0;
+    });
+    std::cout << finishedCount << " of " << points.size() << " points finished\n";
+    return WriteResultsFile(*config, records);
+}
@@ -0,0 +1,39 @@
+#include "experiments.hpp"
+
+std::function<std::unique_ptr<Job>()> CreateJobGenerator(SimulationContext &context, unsigned int hostCountTraceIdx,
+                                                         unsigned int jobCount, std::optional<double> arrivalRate) {
+    assert(hostCountTraceIdx < HostCountTraces.size());
+    assert(!arrivalRate || *arrivalRate > 0.0);
+    std::vector<unsigned int> hostCountList, weightList;
+    for (auto [hostCount, weight] : HostCountTraces[hostCountTraceIdx]) {
+        hostCountList.push_back(hostCount);
+        weightList.push_back(weight);
+    }
+    // Not SyntheticWorkload, whose AliasSampler draws other host counts, so that the experiments keep their jobs
+    std::discrete_distribution<std::size_t> randomHostCount(weightList.cbegin(), weightList.cend());
+    return [&context, hostCountList = std::move(hostCountList), randomHostCount = std::move(randomHostCount), jobCount,
+            arrivalRate, engine = std::default_random_engine(42), createdJobCount = 0u,
+            arrivalTime = 0.0]() mutable -> std::unique_ptr<Job> {
+        if (createdJobCount >= jobCount)
+            return nullptr;
+        ++createdJobCount;
+        std::uniform_int_distribution<std::size_t> randomModel(0, ModelList.size() - 1);
+        std::uniform_int_distribution<std::size_t> randomStepCount(0, StepCountList.size() - 1);
+        std::string_view model = ModelList[randomModel(engine)];
+        auto hostCount = hostCountList[randomHostCount(engine)];
+        auto stepCount = StepCountList[randomStepCount(engine)];
+        // Drawn last, so that the other draws do not depend on the arrival rate
+        if (arrivalRate)
+            arrivalTime += std::exponential_distribution<double>(*arrivalRate)(engine);
+        return std::make_unique<Job>(context, model, hostCount, stepCount, arrivalTime);
+    };
+}
+
+std::function<std::unique_ptr<Job>()> CreateSyntheticJobGenerator(SimulationContext &context,
+                                                                  unsigned int hostCountTraceIdx, unsigned int jobCount,
+                                                                  std::optional<double> arrivalRate) {
+    assert(hostCountTraceIdx < HostCountTraces.size());
+    auto workload = std::make_shared<SyntheticWorkload>(ModelList, HostCountTraces[hostCountTraceIdx], StepCountList,
+                                                        jobCount, arrivalRate);
+    return CreateWorkloadJobGenerator(context, std::move(workload));
+}
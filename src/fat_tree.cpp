@@ -1,7 +1,6 @@
 #include "fat_tree.hpp"
 #include <algorithm>
 #include <cassert>
-#include <queue>
 
 std::ostream &operator<<(std::ostream &os, const FatTree::Node &node) {
     os << "Node(ID=" << node.ID << ",Layer=" << node.Layer << ",Indices=";
@@ -17,7 +16,7 @@ std::ostream &operator<<(std::ostream &os, const FatTree::Edge &edge) {
 }
 
 bool operator==(const FatTree::AggrTree &tree1, const FatTree::AggrTree &tree2) {
-    return tree1.Nodes == tree2.Nodes && tree1.Edges == tree2.Edges;
+    return tree1.NodeIDs == tree2.NodeIDs && tree1.EdgeIDs == tree2.EdgeIDs;
 }
 
 bool operator!=(const FatTree::AggrTree &tree1, const FatTree::AggrTree &tree2) {
@@ -162,34 +161,27 @@ std::vector<const FatTree::Node *> FatTree::GetClosestCommonAncestors(const std:
 
 FatTree::AggrTree FatTree::GetAggregationTree(const std::vector<const Node *> &leaves, const Node *root) const {
     assert(leaves.size() > 0);
-    std::vector<const Node *> nodes;
-    std::vector<const Edge *> edges;
-    std::vector<char> nodeSet(Nodes.size(), false);
-    std::vector<char> edgeSet(Edges.size(), false);
-    for (auto leaf : leaves) {
-        assert(leaf->Layer == 0);
-        nodes.push_back(leaf);
-        nodeSet[leaf->ID] = true;
-    }
-    std::queue<const Node *> queue;
-    for (auto leaf : leaves)
-        queue.push(leaf);
-    while (!queue.empty()) {
-        auto child = queue.front();
-        queue.pop();
-        if (child == root)
-            continue;
-        auto parentIndices = child->Indices;
-        parentIndices[child->Layer] = root->Indices[child->Layer];
-        auto parent = &Nodes[GetNodeID(child->Layer + 1, parentIndices)];
-        auto edgeId = GetEdgeID(parent, child);
-        edges.push_back(&Edges[edgeId]);
-        edgeSet[edgeId] = true;
-        if (!nodeSet[parent->ID]) {
-            nodes.push_back(parent);
-            nodeSet[parent->ID] = true;
-            queue.push(parent);
+    std::vector<unsigned int> nodeIDs, edgeIDs;
+    // Walk up layer by layer, every node has exactly one parent towards the root
+    std::vector<const Node *> layerNodes = leaves, parents;
+    for (unsigned int layer = 0; layer < root->Layer; ++layer) {
+        parents.clear();
+        for (auto child : layerNodes) {
+            assert(child->Layer == layer);
+            nodeIDs.push_back(child->ID);
+            auto parentIndices = child->Indices;
+            parentIndices[layer] = root->Indices[layer];
+            auto parent = &Nodes[GetNodeID(layer + 1, parentIndices)];
+            edgeIDs.push_back(GetEdgeID(parent, child));
+            parents.push_back(parent);
         }
+        std::sort(parents.begin(), parents.end());
+        parents.erase(std::unique(parents.begin(), parents.end()), parents.end());
+        std::swap(layerNodes, parents);
     }
-    return AggrTree(std::move(nodes), std::move(edges), std::move(nodeSet), std::move(edgeSet));
+    assert(layerNodes.size() == 1 && layerNodes.front() == root);
+    nodeIDs.push_back(root->ID);
+    std::sort(nodeIDs.begin(), nodeIDs.end());
+    std::sort(edgeIDs.begin(), edgeIDs.end());
+    return AggrTree(std::move(nodeIDs), std::move(edgeIDs));
 }
@@ -31,16 +31,14 @@ public:
         friend std::ostream &operator<<(std::ostream &os, const Edge &edge);
     };
 
+    // An aggregation tree, stored as the sorted IDs of its nodes (including the leaves) and edges.
     class AggrTree {
     public:
-        std::vector<const Node *> Nodes;
-        std::vector<const Edge *> Edges;
-        std::vector<char> NodeSet, EdgeSet;
+        std::vector<unsigned int> NodeIDs;
+        std::vector<unsigned int> EdgeIDs;
 
-        explicit AggrTree(std::vector<const Node *> &&nodes, std::vector<const Edge *> &&edges,
-                          std::vector<char> &&nodeSet, std::vector<char> &&edgeSet)
-            : Nodes(std::move(nodes)), Edges(std::move(edges)), NodeSet(std::move(nodeSet)),
-              EdgeSet(std::move(edgeSet)) {}
+        explicit AggrTree(std::vector<unsigned int> &&nodeIDs, std::vector<unsigned int> &&edgeIDs)
+            : NodeIDs(std::move(nodeIDs)), EdgeIDs(std::move(edgeIDs)) {}
 
         friend bool operator==(const AggrTree &tree1, const AggrTree &tree2);
         friend bool operator!=(const AggrTree &tree1, const AggrTree &tree2);
@@ -1,105 +1,210 @@
 #include "fat_tree_resource.hpp"
+#include <algorithm>
 #include <cassert>
 
-unsigned int FatTreeResource::CalcHostFragments(bool available, unsigned int beginHostIdx, unsigned int hostCountInPod,
-                                                unsigned int level) const {
-    const auto &hosts = Topology->NodesByLayer[0];
-    bool allAvailable = true, noneAvailable = true;
-    for (auto hostIdx = beginHostIdx; hostIdx < beginHostIdx + hostCountInPod; ++hostIdx)
-        if (m_NodeUsage[hosts[hostIdx]->ID] == 0)
-            noneAvailable = false;
+// Both ID lists are sorted, so a common ID is found by merging them in O(|ids1| + |ids2|).
+static bool HasCommonID(const std::vector<unsigned int> &ids1, const std::vector<unsigned int> &ids2) {
+    if (ids1.empty() || ids2.empty() || ids1.back() < ids2.front() || ids2.back() < ids1.front())
+        return false;
+    auto iter1 = ids1.cbegin(), iter2 = ids2.cbegin();
+    while (iter1 != ids1.cend() && iter2 != ids2.cend()) {
+        if (*iter1 == *iter2)
+            return true;
+        if (*iter1 < *iter2)
+            ++iter1;
         else
-            allAvailable = false;
-    if (allAvailable)
+            ++iter2;
+    }
+    return false;
+}
+
+FatTreeResource::TreeIndex::TreeIndex(const FatTree &topology, std::optional<unsigned int> nodeQuota,
+                                      std::optional<unsigned int> linkQuota)
+    : m_IndexNodes(nodeQuota && *nodeQuota < 2), m_IndexEdges(linkQuota && *linkQuota < 2),
+      m_NodeToTrees(m_IndexNodes ? topology.Nodes.size() : 0),
+      m_EdgeToTrees(m_IndexEdges ? topology.Edges.size() : 0) {}
+
+void FatTreeResource::TreeIndex::Add(unsigned int treeId, const AggrTree &tree) {
+    assert(!Contains(treeId));
+    auto &[nodeIDs, edgeIDs] = m_Trees[treeId];
+    if (m_IndexNodes) {
+        nodeIDs = tree.NodeIDs;
+        for (auto nodeID : nodeIDs)
+            m_NodeToTrees[nodeID].push_back(treeId);
+    }
+    if (m_IndexEdges) {
+        edgeIDs = tree.EdgeIDs;
+        for (auto edgeID : edgeIDs)
+            m_EdgeToTrees[edgeID].push_back(treeId);
+    }
+}
+
+void FatTreeResource::TreeIndex::Remove(unsigned int treeId) {
+    auto iter = m_Trees.find(treeId);
+    assert(iter != m_Trees.end());
+    auto removeFrom = [treeId](std::vector<unsigned int> &trees) {
+        auto treeIter = std::find(trees.begin(), trees.end(), treeId);
+        assert(treeIter != trees.end());
+        *treeIter = trees.back();
+        trees.pop_back();
+    };
+    const auto &[nodeIDs, edgeIDs] = iter->second;
+    for (auto nodeID : nodeIDs)
+        removeFrom(m_NodeToTrees[nodeID]);
+    for (auto edgeID : edgeIDs)
+        removeFrom(m_EdgeToTrees[edgeID]);
+    m_Trees.erase(iter);
+}
+
+bool FatTreeResource::TreeIndex::HasConflictingTrees(const AggrTree &tree) const {
+    if (m_IndexNodes)
+        for (auto nodeID : tree.NodeIDs)
+            if (!m_NodeToTrees[nodeID].empty())
+                return true;
+    if (m_IndexEdges)
+        for (auto edgeID : tree.EdgeIDs)
+            if (!m_EdgeToTrees[edgeID].empty())
+                return true;
+    return false;
+}
+
+std::vector<unsigned int> FatTreeResource::TreeIndex::GetConflictingTrees(const AggrTree &tree) const {
+    std::vector<unsigned int> result;
+    if (m_IndexNodes)
+        for (auto nodeID : tree.NodeIDs) {
+            const auto &trees = m_NodeToTrees[nodeID];
+            result.insert(result.end(), trees.cbegin(), trees.cend());
+        }
+    if (m_IndexEdges)
+        for (auto edgeID : tree.EdgeIDs) {
+            const auto &trees = m_EdgeToTrees[edgeID];
+            result.insert(result.end(), trees.cbegin(), trees.cend());
+        }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+unsigned int FatTreeResource::CalcHostFragments(bool available, unsigned int level, unsigned int podIdx) const {
+    auto usedHostCount = m_UsedHostCounts[level][podIdx];
+    if (usedHostCount == 0)
         return available;
-    if (noneAvailable)
+    if (usedHostCount == m_PodHostCounts[level])
         return !available;
+    // Only pods partially used have to be split, and a host is either free or used
     assert(level > 0);
-    assert(hostCountInPod > 1);
-    unsigned int sum = 0, hostCountInSubPod = hostCountInPod / Topology->DownLinkCount[level - 1];
-    for (unsigned int subPodBeginHostIdx = beginHostIdx; subPodBeginHostIdx < beginHostIdx + hostCountInPod;
-         subPodBeginHostIdx += hostCountInSubPod)
-        sum += CalcHostFragments(available, subPodBeginHostIdx, hostCountInSubPod, level - 1);
+    unsigned int sum = 0, subPodCount = Topology->DownLinkCount[level - 1];
+    for (unsigned int subPodIdx = podIdx * subPodCount; subPodIdx < (podIdx + 1) * subPodCount; ++subPodIdx)
+        sum += CalcHostFragments(available, level - 1, subPodIdx);
     return sum;
 }
 
 FatTreeResource::FatTreeResource(const FatTree &topology, std::optional<unsigned int> nodeQuota,
                                  std::optional<unsigned int> linkQuota)
-    : m_NodeUsage(topology.Nodes.size(), 0), m_EdgeUsage(topology.Edges.size(), 0), Topology(&topology),
-      NodeQuota(nodeQuota), LinkQuota(linkQuota) {
+    : m_NodeUsage(topology.Nodes.size(), 0), m_EdgeUsage(topology.Edges.size(), 0),
+      m_RegisteredTrees(topology, nodeQuota, linkQuota), Topology(&topology), NodeQuota(nodeQuota),
+      LinkQuota(linkQuota) {
     assert(!NodeQuota || *NodeQuota > 0);
     assert(!LinkQuota || *LinkQuota > 0);
+    auto hostCount = topology.NodesByLayer[0].size();
+    for (unsigned int level = 0; level <= FatTree::Height; ++level) {
+        m_PodHostCounts[level] = level == 0 ? 1 : m_PodHostCounts[level - 1] * topology.DownLinkCount[level - 1];
+        m_UsedHostCounts[level].resize(hostCount / m_PodHostCounts[level], 0);
+        m_PodVersions[level].resize(hostCount / m_PodHostCounts[level], 0);
+    }
+    assert(m_PodHostCounts[FatTree::Height] == hostCount);
+    m_FreeHostBits.resize((hostCount + 63) / 64, ~std::uint64_t(0));
+    if (hostCount % 64 != 0)
+        m_FreeHostBits.back() = (std::uint64_t(1) << hostCount % 64) - 1;
+    m_FreeHostSummary.resize((m_FreeHostBits.size() + 63) / 64, ~std::uint64_t(0));
+    if (m_FreeHostBits.size() % 64 != 0)
+        m_FreeHostSummary.back() = (std::uint64_t(1) << m_FreeHostBits.size() % 64) - 1;
 }
 
 void FatTreeResource::Allocate(const AggrTree &tree) {
-    for (auto node : tree.Nodes) {
-        if (node->Layer == 0)
+    for (auto nodeID : tree.NodeIDs) {
+        if (Topology->Nodes[nodeID].Layer == 0)
             continue;
-        assert(!NodeQuota || m_NodeUsage[node->ID] < *NodeQuota);
-        ++m_NodeUsage[node->ID];
+        assert(!NodeQuota || m_NodeUsage[nodeID] < *NodeQuota);
+        ++m_NodeUsage[nodeID];
     }
-    for (auto edge : tree.Edges) {
-        assert(!LinkQuota || m_EdgeUsage[edge->ID] < *LinkQuota);
-        ++m_EdgeUsage[edge->ID];
+    for (auto edgeID : tree.EdgeIDs) {
+        assert(!LinkQuota || m_EdgeUsage[edgeID] < *LinkQuota);
+        ++m_EdgeUsage[edgeID];
     }
 }
 
 void FatTreeResource::Allocate(const std::vector<const Node *> &hosts) {
+    ++m_HostVersion;
     for (auto node : hosts) {
         assert(node->Layer == 0);
         assert(!NodeQuota || m_NodeUsage[node->ID] < *NodeQuota);
-        ++m_NodeUsage[node->ID];
+        // Hosts come first in Nodes, so the ID of a host is also its index in NodesByLayer[0]
+        if (m_NodeUsage[node->ID]++ > 0)
+            continue;
+        for (unsigned int level = 0; level <= FatTree::Height; ++level) {
+            ++m_UsedHostCounts[level][node->ID / m_PodHostCounts[level]];
+            m_PodVersions[level][node->ID / m_PodHostCounts[level]] = m_HostVersion;
+        }
+        auto &word = m_FreeHostBits[node->ID / 64];
+        word &= ~(std::uint64_t(1) << node->ID % 64);
+        if (word == 0)
+            m_FreeHostSummary[node->ID / 4096] &= ~(std::uint64_t(1) << node->ID / 64 % 64);
     }
 }
 
 void FatTreeResource::Deallocate(const AggrTree &tree) {
-    for (auto node : tree.Nodes) {
-        if (node->Layer == 0)
+    for (auto nodeID : tree.NodeIDs) {
+        if (Topology->Nodes[nodeID].Layer == 0)
             continue;
-        assert(m_NodeUsage[node->ID] > 0);
-        --m_NodeUsage[node->ID];
+        assert(m_NodeUsage[nodeID] > 0);
+        --m_NodeUsage[nodeID];
     }
-    for (auto edge : tree.Edges) {
-        assert(m_EdgeUsage[edge->ID] > 0);
-        --m_EdgeUsage[edge->ID];
+    for (auto edgeID : tree.EdgeIDs) {
+        assert(m_EdgeUsage[edgeID] > 0);
+        --m_EdgeUsage[edgeID];
     }
 }
 
 void FatTreeResource::Deallocate(const std::vector<const Node *> &hosts) {
+    ++m_HostVersion;
     for (auto node : hosts) {
         assert(node->Layer == 0);
         assert(m_NodeUsage[node->ID] > 0);
-        --m_NodeUsage[node->ID];
+        if (--m_NodeUsage[node->ID] > 0)
+            continue;
+        for (unsigned int level = 0; level <= FatTree::Height; ++level) {
+            --m_UsedHostCounts[level][node->ID / m_PodHostCounts[level]];
+            m_PodVersions[level][node->ID / m_PodHostCounts[level]] = m_HostVersion;
+        }
+        m_FreeHostBits[node->ID / 64] |= std::uint64_t(1) << node->ID % 64;
+        m_FreeHostSummary[node->ID / 4096] |= std::uint64_t(1) << node->ID / 64 % 64;
     }
 }
 
 bool FatTreeResource::CheckTreeConflict(const AggrTree &tree) const {
     if (NodeQuota)
-        for (auto node : tree.Nodes) {
-            if (node->Layer == 0)
+        for (auto nodeID : tree.NodeIDs) {
+            if (Topology->Nodes[nodeID].Layer == 0)
                 continue;
-            if (m_NodeUsage[node->ID] >= *NodeQuota)
+            if (m_NodeUsage[nodeID] >= *NodeQuota)
                 return true;
         }
     if (LinkQuota)
-        for (auto edge : tree.Edges)
-            if (m_EdgeUsage[edge->ID] >= *LinkQuota)
+        for (auto edgeID : tree.EdgeIDs)
+            if (m_EdgeUsage[edgeID] >= *LinkQuota)
                 return true;
     return false;
 }
 
 bool FatTreeResource::CheckTreeConflict(const AggrTree &tree1, const AggrTree &tree2) const {
-    if (NodeQuota && *NodeQuota < 2)
-        for (auto node : tree1.Nodes)
-            if (tree2.NodeSet[node->ID])
-                return true;
-    if (LinkQuota && *LinkQuota < 2)
-        for (auto edge : tree1.Edges)
-            if (tree2.EdgeSet[edge->ID])
-                return true;
+    if (NodeQuota && *NodeQuota < 2 && HasCommonID(tree1.NodeIDs, tree2.NodeIDs))
+        return true;
+    if (LinkQuota && *LinkQuota < 2 && HasCommonID(tree1.EdgeIDs, tree2.EdgeIDs))
+        return true;
     return false;
 }
 
 unsigned int FatTreeResource::CalcHostFragments(bool available) const {
-    return CalcHostFragments(available, 0, Topology->NodesByLayer[0].size(), Topology->Height);
+    return CalcHostFragments(available, FatTree::Height, 0);
 }
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "fat_tree.hpp"
+#include <array>
+#include <cstdint>
 #include <optional>
+#include <unordered_map>
 #include <vector>
 
 class FatTreeResource {
@@ -10,11 +13,50 @@ private:
     using Edge = typename FatTree::Edge;
     using AggrTree = typename FatTree::AggrTree;
 
+public:
+    // Inverted index from nodes and edges to the trees occupying them. Finding all trees that conflict with a tree
+    // takes O(|tree| + output) instead of checking every tree pairwise. Conflicts are defined the same way as in
+    // FatTreeResource::CheckTreeConflict(tree1, tree2).
+    class TreeIndex {
+    private:
+        bool m_IndexNodes, m_IndexEdges;
+        // Node/Edge ID -> IDs of the trees occupying it
+        std::vector<std::vector<unsigned int>> m_NodeToTrees, m_EdgeToTrees;
+        // Tree ID -> (indexed node IDs, indexed edge IDs)
+        std::unordered_map<unsigned int, std::pair<std::vector<unsigned int>, std::vector<unsigned int>>> m_Trees;
+
+    public:
+        explicit TreeIndex(const FatTree &topology, std::optional<unsigned int> nodeQuota,
+                           std::optional<unsigned int> linkQuota);
+        explicit TreeIndex(const FatTreeResource &resources)
+            : TreeIndex(*resources.Topology, resources.NodeQuota, resources.LinkQuota) {}
+
+        bool Contains(unsigned int treeId) const { return m_Trees.count(treeId) > 0; }
+        void Add(unsigned int treeId, const AggrTree &tree);
+        void Remove(unsigned int treeId);
+        bool HasConflictingTrees(const AggrTree &tree) const;
+        // Returns the IDs of all trees in the index that conflict with the given tree, in ascending order.
+        std::vector<unsigned int> GetConflictingTrees(const AggrTree &tree) const;
+    };
+
+private:
     std::vector<unsigned int> m_NodeUsage;
     std::vector<unsigned int> m_EdgeUsage;
+    TreeIndex m_RegisteredTrees;
+    // Level -> # of hosts in each pod of the level
+    std::array<unsigned int, FatTree::Height + 1> m_PodHostCounts;
+    // Level -> pod index -> # of used hosts in the pod, maintained by Allocate and Deallocate
+    std::array<std::vector<unsigned int>, FatTree::Height + 1> m_UsedHostCounts;
+    // Level -> pod index -> the value of m_HostVersion when a host of the pod last changed
+    std::array<std::vector<unsigned int>, FatTree::Height + 1> m_PodVersions;
+    // Incremented on every allocation or deallocation of hosts
+    unsigned int m_HostVersion = 0;
+    // Bit i of word w is set if host w * 64 + i is free
+    std::vector<std::uint64_t> m_FreeHostBits;
+    // Bit i of word w is set if word w * 64 + i of m_FreeHostBits is not zero
+    std::vector<std::uint64_t> m_FreeHostSummary;
 
-    unsigned int CalcHostFragments(bool available, unsigned int beginHostIdx, unsigned int hostCountInPod,
-                                   unsigned int level) const;
+    unsigned int CalcHostFragments(bool available, unsigned int level, unsigned int podIdx) const;
 
 public:
     const FatTree *Topology;
@@ -26,6 +68,24 @@ public:
     const std::vector<unsigned int> &GetNodeUsage() const { return m_NodeUsage; }
     const std::vector<unsigned int> &GetEdgeUsage() const { return m_EdgeUsage; }
 
+    // Hosts are grouped into pods level by level: a pod of level l > 0 consists of DownLinkCount[l - 1] pods of level
+    // l - 1, whose hosts are contiguous in NodesByLayer[0]. A pod of level 0 is a host, and the only pod of level
+    // Height is the whole cluster. The host counts of pods are O(1) to query.
+    unsigned int GetPodHostCount(unsigned int level) const { return m_PodHostCounts[level]; }
+    unsigned int GetUsedHostCount(unsigned int level, unsigned int podIdx) const {
+        return m_UsedHostCounts[level][podIdx];
+    }
+    unsigned int GetFreeHostCount(unsigned int level, unsigned int podIdx) const {
+        return m_PodHostCounts[level] - m_UsedHostCounts[level][podIdx];
+    }
+    unsigned int GetFreeHostCount() const { return GetFreeHostCount(FatTree::Height, 0); }
+    // The free hosts, indexed as in NodesByLayer[0], packed into words so that they can be scanned 64 at a time.
+    const std::vector<std::uint64_t> &GetFreeHostBits() const { return m_FreeHostBits; }
+    // The nonzero words of GetFreeHostBits(), to skip the used hosts of a busy cluster 4096 at a time.
+    const std::vector<std::uint64_t> &GetFreeHostSummary() const { return m_FreeHostSummary; }
+    // Changes whenever a host of the pod turns used or free, so that anything derived from the pod can be cached.
+    unsigned int GetPodVersion(unsigned int level, unsigned int podIdx) const { return m_PodVersions[level][podIdx]; }
+
     void Allocate(const AggrTree &tree);
     void Allocate(const std::vector<const Node *> &hosts);
     void Deallocate(const AggrTree &tree);
@@ -33,5 +93,15 @@ public:
     bool CheckTreeConflict(const AggrTree &tree) const;
     bool CheckTreeConflict(const AggrTree &tree1, const AggrTree &tree2) const;
 
+    // Registered trees are the aggregation trees the running jobs are going to use, identified by job ID. They do
+    // not occupy any resources, but can be queried for conflicts with GetConflictingTrees.
+    bool IsTreeRegistered(unsigned int treeId) const { return m_RegisteredTrees.Contains(treeId); }
+    void RegisterTree(unsigned int treeId, const AggrTree &tree) { m_RegisteredTrees.Add(treeId, tree); }
+    void UnregisterTree(unsigned int treeId) { m_RegisteredTrees.Remove(treeId); }
+    bool HasConflictingTrees(const AggrTree &tree) const { return m_RegisteredTrees.HasConflictingTrees(tree); }
+    std::vector<unsigned int> GetConflictingTrees(const AggrTree &tree) const {
+        return m_RegisteredTrees.GetConflictingTrees(tree);
+    }
+
     unsigned int CalcHostFragments(bool available) const;
 };
@@ -1,17 +1,24 @@
 #include "first.hpp"
+#include "utils/bits.hpp"
 #include <cassert>
 
 std::optional<std::vector<const FatTree::Node *>>
 FirstHostAllocationPolicy::operator()(const FatTreeResource &resources, unsigned int hostCount) const {
     assert(hostCount > 0);
-    const auto &nodeUsage = resources.GetNodeUsage();
+    if (resources.GetFreeHostCount() < hostCount)
+        return std::nullopt;
+    const auto &freeHostBits = resources.GetFreeHostBits();
+    const auto &freeHostSummary = resources.GetFreeHostSummary();
     const auto &hosts = resources.Topology->NodesByLayer[0];
     std::vector<const Node *> availableHosts;
-    for (unsigned int hostId = 0; hostId < hosts.size(); ++hostId)
-        if (nodeUsage[hostId] == 0) {
-            availableHosts.push_back(hosts[hostId]);
-            if (availableHosts.size() == hostCount)
-                return availableHosts;
+    availableHosts.reserve(hostCount);
+    for (unsigned int summaryIdx = 0;; ++summaryIdx)
+        for (auto summary = freeHostSummary[summaryIdx]; summary != 0; summary &= summary - 1) {
+            auto wordIdx = summaryIdx * 64 + CountTrailingZeros(summary);
+            for (auto word = freeHostBits[wordIdx]; word != 0; word &= word - 1) {
+                availableHosts.push_back(hosts[wordIdx * 64 + CountTrailingZeros(word)]);
+                if (availableHosts.size() == hostCount)
+                    return availableHosts;
+            }
         }
-    return std::nullopt;
 }
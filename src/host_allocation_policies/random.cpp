@@ -1,21 +1,38 @@
 #include "random.hpp"
+#include "utils/bits.hpp"
 #include <algorithm>
 #include <cassert>
-#include <random>
 
 std::optional<std::vector<const FatTree::Node *>>
-RandomHostAllocationPolicy::operator()(const FatTreeResource &resources, unsigned int hostCount) const {
+RandomHostAllocationPolicy::operator()(const FatTreeResource &resources, unsigned int hostCount) {
     assert(hostCount > 0);
-    const auto &nodeUsage = resources.GetNodeUsage();
-    const auto &hosts = resources.Topology->NodesByLayer[0];
-    std::vector<const Node *> availableHosts;
-    for (unsigned int hostId = 0; hostId < hosts.size(); ++hostId)
-        if (nodeUsage[hostId] == 0)
-            availableHosts.push_back(hosts[hostId]);
-    if (availableHosts.size() < hostCount)
+    auto freeHostCount = resources.GetFreeHostCount();
+    if (freeHostCount < hostCount)
         return std::nullopt;
+    // Floyd's algorithm draws hostCount distinct ranks among the free hosts, kept sorted
+    m_Ranks.clear();
+    for (auto maxRank = freeHostCount - hostCount; maxRank < freeHostCount; ++maxRank) {
+        auto rank = std::uniform_int_distribution<unsigned int>(0, maxRank)(m_Engine);
+        auto iter = std::lower_bound(m_Ranks.begin(), m_Ranks.end(), rank);
+        // maxRank is larger than all ranks drawn before
+        if (iter != m_Ranks.end() && *iter == rank)
+            m_Ranks.push_back(maxRank);
+        else
+            m_Ranks.insert(iter, rank);
+    }
+    // The host of each rank is found by counting the free hosts word by word
+    const auto &freeHostBits = resources.GetFreeHostBits();
+    const auto &hosts = resources.Topology->NodesByLayer[0];
     std::vector<const Node *> chosenHosts;
-    thread_local std::default_random_engine engine(42);
-    std::sample(availableHosts.cbegin(), availableHosts.cend(), std::back_inserter(chosenHosts), hostCount, engine);
+    chosenHosts.reserve(hostCount);
+    unsigned int wordIdx = 0, wordBeginRank = 0;
+    for (auto rank : m_Ranks) {
+        while (wordBeginRank + PopCount(freeHostBits[wordIdx]) <= rank)
+            wordBeginRank += PopCount(freeHostBits[wordIdx++]);
+        auto word = freeHostBits[wordIdx];
+        for (auto i = wordBeginRank; i < rank; ++i)
+            word &= word - 1;
+        chosenHosts.push_back(hosts[wordIdx * 64 + CountTrailingZeros(word)]);
+    }
     return chosenHosts;
 }
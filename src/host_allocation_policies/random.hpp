@@ -3,12 +3,18 @@
 #include "fat_tree.hpp"
 #include "fat_tree_resource.hpp"
 #include <optional>
+#include <random>
 #include <vector>
 
 class RandomHostAllocationPolicy {
 private:
     using Node = typename FatTree::Node;
 
+    // Each policy draws its own sequence, independent of the thread running the simulation
+    std::default_random_engine m_Engine{42};
+    // Scratch buffer of the ranks of the chosen hosts among the free hosts
+    std::vector<unsigned int> m_Ranks;
+
 public:
-    std::optional<std::vector<const Node *>> operator()(const FatTreeResource &resources, unsigned int hostCount) const;
+    std::optional<std::vector<const Node *>> operator()(const FatTreeResource &resources, unsigned int hostCount);
 };
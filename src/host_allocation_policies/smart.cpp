@@ -1,72 +1,131 @@
 #include "smart.hpp"
+#include "utils/min_plus_convolution.hpp"
 #include <algorithm>
 #include <cassert>
-#include <limits>
+#include <iterator>
 
-unsigned int SmartHostAllocationPolicy::TryAllocate(const FatTreeResource &resources, unsigned int beginHostIdx,
-                                                    unsigned int hostCountInPod, unsigned int level,
-                                                    std::vector<TryAllocateResult> &result) const {
-    assert(result.size() >= 2);
-    const auto &nodeUsage = resources.GetNodeUsage();
-    const auto &hosts = resources.Topology->NodesByLayer[0];
-    if (level == 0) {
-        assert(hostCountInPod == 1);
-        if (nodeUsage[hosts[beginHostIdx]->ID] > 0) {
-            result[0].FragmentScore = 0;
-            result[0].Hosts.clear();
-            return 0;
+void SmartHostAllocationPolicy::MergeSubPod(double *scores, unsigned int availHostCount, const double *subPodScores,
+                                            unsigned int subPodAvailHostCount, unsigned int requiredHostCount,
+                                            unsigned int *choices) {
+    auto size = std::min(availHostCount, requiredHostCount) + 1;
+    m_ReversedScores.assign(std::make_reverse_iterator(scores + size), std::make_reverse_iterator(scores));
+    MinPlusConvolution(subPodScores, std::min(subPodAvailHostCount, requiredHostCount) + 1, m_ReversedScores.data(),
+                       size, scores, choices, std::min(availHostCount + subPodAvailHostCount, requiredHostCount) + 1);
+}
+
+void SmartHostAllocationPolicy::UpdateFreePodTables(const FatTreeResource &resources, unsigned int hostCount) {
+    // The tables only grow, since the first entries do not depend on the host count
+    if (hostCount <= m_FreePodTableHostCount)
+        return;
+    m_FreePodTableHostCount = hostCount;
+    for (unsigned int level = 0; level <= FatTree::Height; ++level) {
+        auto hostCountInPod = resources.GetPodHostCount(level);
+        auto &scores = m_FreePodScores[level];
+        scores.assign(std::min(hostCountInPod, hostCount) + 1, 0.0);
+        if (level > 0) {
+            auto subPodCount = resources.Topology->DownLinkCount[level - 1];
+            auto hostCountInSubPod = resources.GetPodHostCount(level - 1);
+            auto &choices = m_FreePodChoices[level];
+            choices.resize(subPodCount * scores.size());
+            for (unsigned int i = 0; i < subPodCount; ++i)
+                MergeSubPod(scores.data(), i * hostCountInSubPod, m_FreePodScores[level - 1].data(), hostCountInSubPod,
+                            hostCount, &choices[i * scores.size()]);
         }
-        result[0].FragmentScore = Alpha;
-        result[0].Hosts.clear();
-        result[1].FragmentScore = 1;
-        result[1].Hosts.clear();
-        result[1].Hosts.push_back(hosts[beginHostIdx]);
-        return 1;
+        scores[0] = Alpha;
+        if (hostCountInPod <= hostCount)
+            scores[hostCountInPod] = 1;
     }
-    result[0].FragmentScore = 0.0;
-    result[0].Hosts.clear();
-    unsigned int totalAvailHostCount = 0,
-                 hostCountInSubPod = hostCountInPod / resources.Topology->DownLinkCount[level - 1],
-                 requiredHostCount = result.size() - 1;
-    std::vector<TryAllocateResult> subPodResult(requiredHostCount + 1);
-    for (unsigned int subPodBeginHostIdx = beginHostIdx; subPodBeginHostIdx < beginHostIdx + hostCountInPod;
-         subPodBeginHostIdx += hostCountInSubPod) {
-        auto subPodAvailHostCount =
-            TryAllocate(resources, subPodBeginHostIdx, hostCountInSubPod, level - 1, subPodResult);
-        for (int hostCount = std::min(totalAvailHostCount + subPodAvailHostCount, requiredHostCount); hostCount >= 0;
-             --hostCount) {
-            double minFragmentScore = std::numeric_limits<double>::max();
-            unsigned int minI;
-            for (unsigned int i = std::max(0, hostCount - static_cast<int>(totalAvailHostCount)), j = hostCount - i;
-                 i <= std::min<unsigned int>(subPodAvailHostCount, hostCount); ++i, --j)
-                if (minFragmentScore > subPodResult[i].FragmentScore + result[j].FragmentScore) {
-                    minFragmentScore = subPodResult[i].FragmentScore + result[j].FragmentScore;
-                    minI = i;
-                }
-            result[hostCount].FragmentScore = minFragmentScore;
-            result[hostCount].Hosts.resize(hostCount);
-            for (unsigned int i = 0; i < hostCount - minI; ++i)
-                result[hostCount].Hosts[i] = result[hostCount - minI].Hosts[i];
-            for (unsigned int i = hostCount - minI; i < static_cast<unsigned int>(hostCount); ++i)
-                result[hostCount].Hosts[i] = subPodResult[minI].Hosts[i - (hostCount - minI)];
+}
+
+void SmartHostAllocationPolicy::UpdatePodTable(const FatTreeResource &resources, unsigned int level,
+                                               unsigned int podIdx, unsigned int hostCount) {
+    assert(level > 0);
+    auto &table = m_PodTables[level][podIdx];
+    auto tableSize = std::min(resources.GetPodHostCount(level), hostCount) + 1;
+    if (table.Version == resources.GetPodVersion(level, podIdx) && table.Scores.size() >= tableSize)
+        return;
+    table.Version = resources.GetPodVersion(level, podIdx);
+    table.Scores.assign(tableSize, 0.0);
+    table.Steps.clear();
+    table.Choices.clear();
+    unsigned int availHostCount = 0, subPodCount = resources.Topology->DownLinkCount[level - 1],
+                 hostCountInSubPod = resources.GetPodHostCount(level - 1);
+    for (unsigned int subPodIdx = podIdx * subPodCount; subPodIdx < (podIdx + 1) * subPodCount; ++subPodIdx) {
+        auto subPodAvailHostCount = resources.GetFreeHostCount(level - 1, subPodIdx);
+        // A fully used sub-pod adds nothing to the scores
+        if (subPodAvailHostCount == 0)
+            continue;
+        const double *subPodScores = m_FreePodScores[level - 1].data();
+        if (subPodAvailHostCount < hostCountInSubPod) {
+            UpdatePodTable(resources, level - 1, subPodIdx, hostCount);
+            subPodScores = m_PodTables[level - 1][subPodIdx].Scores.data();
         }
-        totalAvailHostCount += subPodAvailHostCount;
+        MergeStep step{subPodIdx, static_cast<unsigned int>(table.Choices.size())};
+        table.Choices.resize(step.ChoiceBegin + std::min(availHostCount + subPodAvailHostCount, hostCount) + 1);
+        MergeSubPod(table.Scores.data(), availHostCount, subPodScores, subPodAvailHostCount, hostCount,
+                    &table.Choices[step.ChoiceBegin]);
+        table.Steps.push_back(step);
+        availHostCount += subPodAvailHostCount;
+    }
+    assert(availHostCount == resources.GetFreeHostCount(level, podIdx));
+}
+
+void SmartHostAllocationPolicy::RebuildFreePodHosts(const FatTreeResource &resources, unsigned int level,
+                                                    unsigned int podIdx, unsigned int hostCount,
+                                                    const Node **hostsEnd) const {
+    if (level == 0) {
+        assert(hostCount <= 1);
+        if (hostCount == 1)
+            *(hostsEnd - 1) = resources.Topology->NodesByLayer[0][podIdx];
+        return;
     }
-    if (totalAvailHostCount == hostCountInPod) {
-        result[0].FragmentScore = Alpha;
-        if (hostCountInPod <= requiredHostCount)
-            result[hostCountInPod].FragmentScore = 1;
+    auto subPodCount = resources.Topology->DownLinkCount[level - 1];
+    const auto &choices = m_FreePodChoices[level];
+    auto stride = m_FreePodScores[level].size();
+    for (auto i = subPodCount; hostCount > 0 && i-- > 0;) {
+        auto subPodHostCount = choices[i * stride + hostCount];
+        RebuildFreePodHosts(resources, level - 1, podIdx * subPodCount + i, subPodHostCount, hostsEnd);
+        hostsEnd -= subPodHostCount;
+        hostCount -= subPodHostCount;
     }
-    return totalAvailHostCount;
+    assert(hostCount == 0);
+}
+
+void SmartHostAllocationPolicy::RebuildHosts(const FatTreeResource &resources, unsigned int level,
+                                             unsigned int podIdx, unsigned int hostCount,
+                                             const Node **hostsEnd) const {
+    if (resources.GetUsedHostCount(level, podIdx) == 0) {
+        RebuildFreePodHosts(resources, level, podIdx, hostCount, hostsEnd);
+        return;
+    }
+    const auto &table = m_PodTables[level][podIdx];
+    assert(table.Version == resources.GetPodVersion(level, podIdx));
+    for (auto stepIdx = table.Steps.size(); hostCount > 0 && stepIdx-- > 0;) {
+        const auto &step = table.Steps[stepIdx];
+        auto subPodHostCount = table.Choices[step.ChoiceBegin + hostCount];
+        RebuildHosts(resources, level - 1, step.SubPodIdx, subPodHostCount, hostsEnd);
+        hostsEnd -= subPodHostCount;
+        hostCount -= subPodHostCount;
+    }
+    assert(hostCount == 0);
 }
 
 std::optional<std::vector<const FatTree::Node *>>
-SmartHostAllocationPolicy::operator()(const FatTreeResource &resources, unsigned int hostCount) const {
+SmartHostAllocationPolicy::operator()(const FatTreeResource &resources, unsigned int hostCount) {
     assert(hostCount > 0);
-    std::vector<TryAllocateResult> result(hostCount + 1);
-    auto nAvailHosts = TryAllocate(resources, 0, resources.Topology->NodesByLayer[0].size(), FatTree::Height, result);
-    if (nAvailHosts < hostCount)
+    if (resources.GetFreeHostCount() < hostCount)
         return std::nullopt;
-    assert(result[hostCount].Hosts.size() == hostCount);
-    return result[hostCount].Hosts;
+    if (m_Topology != resources.Topology) {
+        m_Topology = resources.Topology;
+        for (unsigned int level = 0; level <= FatTree::Height; ++level)
+            m_PodTables[level].assign(m_Topology->NodesByLayer[0].size() / resources.GetPodHostCount(level),
+                                      PodTable());
+        m_FreePodTableHostCount = 0;
+    }
+    UpdateFreePodTables(resources, hostCount);
+    if (resources.GetUsedHostCount(FatTree::Height, 0) > 0)
+        UpdatePodTable(resources, FatTree::Height, 0, hostCount);
+    std::vector<const Node *> hosts(hostCount);
+    RebuildHosts(resources, FatTree::Height, 0, hostCount, hosts.data() + hostCount);
+    return hosts;
 }
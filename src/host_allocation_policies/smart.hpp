@@ -2,20 +2,58 @@
 
 #include "fat_tree.hpp"
 #include "fat_tree_resource.hpp"
+#include <array>
 #include <optional>
 #include <vector>
 
+// Tables are cached across calls, so a policy should only serve one FatTreeResource.
 class SmartHostAllocationPolicy {
 private:
     using Node = typename FatTree::Node;
 
-    struct TryAllocateResult {
-        double FragmentScore;
-        std::vector<const Node *> Hosts;
+    // One step of the DP of a partially used pod, which merges a sub-pod into the sub-pods before it
+    struct MergeStep {
+        unsigned int SubPodIdx;
+        // Offset in PodTable::Choices, where the # of hosts taken from the sub-pod is stored for each total # of hosts
+        // taken from the pod so far
+        unsigned int ChoiceBegin;
     };
 
-    unsigned int TryAllocate(const FatTreeResource &resources, unsigned int beginHostIdx, unsigned int hostCountInPod,
-                             unsigned int level, std::vector<TryAllocateResult> &result) const;
+    // The DP table of a partially used pod, which maps the # of hosts taken from the pod to the minimum fragment score.
+    // Only the scores and choices are kept, and the hosts are rebuilt at the end. A table is valid until the version
+    // of its pod changes, and covers the first Scores.size() host counts, which is enough for any smaller request.
+    struct PodTable {
+        std::optional<unsigned int> Version;
+        std::vector<double> Scores;
+        std::vector<MergeStep> Steps;
+        std::vector<unsigned int> Choices;
+    };
+
+    const FatTree *m_Topology = nullptr;
+    // Level -> pod index -> table
+    std::array<std::vector<PodTable>, FatTree::Height + 1> m_PodTables;
+    // All fully free pods of a level share the same DP table, with the choices of their i-th sub-pod at
+    // i * m_FreePodScores[level].size()
+    std::array<std::vector<double>, FatTree::Height + 1> m_FreePodScores;
+    std::array<std::vector<unsigned int>, FatTree::Height + 1> m_FreePodChoices;
+    unsigned int m_FreePodTableHostCount = 0;
+    std::vector<double> m_ReversedScores;
+
+    // Merges the DP table of a sub-pod into the DP table of the sub-pods before it in place, keeping the first
+    // requiredHostCount + 1 entries. The # of hosts taken from the sub-pod is recorded for each total # of hosts, the
+    // fewest on ties.
+    void MergeSubPod(double *scores, unsigned int availHostCount, const double *subPodScores,
+                     unsigned int subPodAvailHostCount, unsigned int requiredHostCount, unsigned int *choices);
+    void UpdateFreePodTables(const FatTreeResource &resources, unsigned int hostCount);
+    // Makes the table of a partially used pod cover hostCount hosts, recomputing it and the tables below only if they
+    // have changed
+    void UpdatePodTable(const FatTreeResource &resources, unsigned int level, unsigned int podIdx,
+                        unsigned int hostCount);
+    void RebuildFreePodHosts(const FatTreeResource &resources, unsigned int level, unsigned int podIdx,
+                             unsigned int hostCount, const Node **hostsEnd) const;
+    // Writes the hosts chosen from a pod backwards, ending right before hostsEnd
+    void RebuildHosts(const FatTreeResource &resources, unsigned int level, unsigned int podIdx,
+                      unsigned int hostCount, const Node **hostsEnd) const;
 
 public:
     const double Alpha;
@@ -23,5 +61,5 @@ public:
     explicit SmartHostAllocationPolicy(double alpha) : Alpha(alpha) {}
 
     std::optional<std::vector<const FatTree::Node *>> operator()(const FatTreeResource &resources,
-                                                                 unsigned int hostCount) const;
+                                                                 unsigned int hostCount);
 };
@@ -1,15 +1,57 @@
 #include "job.hpp"
 #include "data.hpp"
+#include "simulation_context.hpp"
 #include "utils/trace.hpp"
+#include <algorithm>
 #include <cassert>
 
+std::shared_ptr<const TransmissionDurationTable> Job::GetDurationTable(SimulationContext &context,
+                                                                     const ModelInfo &model, unsigned int hostCount) {
+    std::pair key(model.ID, hostCount);
+    return context.m_DurationTables.GetOrCreate(key, [&] {
+        auto newTable = std::make_shared<TransmissionDurationTable>();
+        for (const auto &opGroup : model.CommOpGroups) {
+            auto offset = newTable->DurationsWithSharp.size();
+            newTable->GroupOffsets.push_back(offset);
+            for (const auto &op : opGroup.CommOps) {
+                newTable->DurationsWithSharp.push_back(
+                    context.CalcTransmissionDuration(op.OpType, op.MessageSize, true, hostCount));
+                newTable->DurationsWithoutSharp.push_back(
+                    context.CalcTransmissionDuration(op.OpType, op.MessageSize, false, hostCount));
+            }
+            // Compose the rest CommOps from the last one
+            newTable->RestDurations.resize(newTable->DurationsWithSharp.size());
+            newTable->RestFinishTimes.resize(newTable->DurationsWithSharp.size());
+            double restDuration = 0.0, restFinishTime = opGroup.SyncTime;
+            for (auto opIdx = opGroup.CommOps.size(); opIdx-- > 0;) {
+                newTable->RestDurations[offset + opIdx] = restDuration;
+                newTable->RestFinishTimes[offset + opIdx] = restFinishTime;
+                auto duration = newTable->DurationsWithoutSharp[offset + opIdx];
+                restFinishTime =
+                    std::max(opGroup.CommOps[opIdx].StartTimeInGroup + duration + restDuration, restFinishTime);
+                restDuration += duration;
+            }
+        }
+        return std::pair(key, std::shared_ptr<const TransmissionDurationTable>(std::move(newTable)));
+    });
+}
+
+double Job::CalcTransmissionDuration(unsigned int groupIdx, unsigned int opIdx, unsigned long long messageSize,
+                                     bool useSharp) const {
+    const auto &op = CommOpGroups[groupIdx].CommOps[opIdx];
+    if (messageSize == op.MessageSize)
+        return GetOpDuration(groupIdx, opIdx, useSharp);
+    return Context.CalcTransmissionDuration(op.OpType, messageSize, useSharp, HostCount);
+}
+
 double Job::CalcStepDuration(bool useSharp) const {
     double stepDuration = 0.0;
-    for (const auto &opGroup : CommOpGroups) {
+    for (unsigned int groupIdx = 0; groupIdx < CommOpGroups.size(); ++groupIdx) {
+        const auto &opGroup = CommOpGroups[groupIdx];
         double groupDuration = 0.0;
-        for (const auto &op : opGroup.CommOps) {
-            auto opDuration = CalcTransmissionDuration(op.OpType, op.MessageSize, useSharp, HostCount);
-            groupDuration = std::max(groupDuration, op.StartTimeInGroup) + opDuration;
+        for (unsigned int opIdx = 0; opIdx < opGroup.CommOps.size(); ++opIdx) {
+            auto opDuration = GetOpDuration(groupIdx, opIdx, useSharp);
+            groupDuration = std::max(groupDuration, opGroup.CommOps[opIdx].StartTimeInGroup) + opDuration;
         }
         groupDuration = std::max(groupDuration, opGroup.SyncTime);
         stepDuration += groupDuration;
@@ -17,14 +59,19 @@ double Job::CalcStepDuration(bool useSharp) const {
     return stepDuration;
 }
 
-Job::Job(std::string_view modelName, unsigned int hostCount, std::optional<unsigned int> stepCount)
-    : ID(m_NextID++), ModelName(modelName), HostCount(hostCount), StepCount(stepCount),
-      CommOpGroups(ModelInfoProvider::GetModelInfo(ModelName)) {
+Job::Job(SimulationContext &context, std::string_view modelName, unsigned int hostCount,
+         std::optional<unsigned int> stepCount, double arrivalTime)
+    : Context(context), ID(context.m_NextJobID++),
+      Model(ModelInfoProvider::GetModelInfo(modelName, context.GPUSpeedupRatio)), ModelName(Model.Name),
+      HostCount(hostCount), StepCount(stepCount), ArrivalTime(arrivalTime), CommOpGroups(Model.CommOpGroups) {
+    m_DurationTable = GetDurationTable(Context, Model, HostCount);
     StepDurationWithSharp = CalcStepDuration(true);
     StepDurationWithoutSharp = CalcStepDuration(false);
 }
 
 double Job::GetNextEvent(double now) const {
+    if (m_IsFastForwarding)
+        return m_FastForwardEventTime;
     if (!m_IsStarted)
         return now;
     assert(!m_IsFinished);
@@ -42,10 +89,20 @@ double Job::GetNextEvent(double now) const {
 }
 
 bool Job::RunNextEvent(double now) {
+    if (m_IsFastForwarding) {
+        auto progress = GetFastForwardProgress();
+        [[maybe_unused]] auto eventTime = RunToVisibleEvent(progress);
+        assert(eventTime == now);
+        SetFastForwardProgress(progress);
+        m_IsFastForwarding = false;
+        return m_IsFinished;
+    }
     if (!m_IsStarted) {
-        Trace.RecordBeginJob(now, *this);
-        Trace.RecordBeginStep(now, *this);
-        Trace.RecordBeginGroup(now, *this);
+        if (m_Tracer) {
+            m_Tracer->RecordBeginJob(now, *this);
+            m_Tracer->RecordBeginStep(now, *this);
+            m_Tracer->RecordBeginGroup(now, *this);
+        }
         m_IsStarted = true;
         m_StartTime = now;
         m_CurrentGroupStartTime = now;
@@ -58,34 +115,41 @@ bool Job::RunNextEvent(double now) {
     if (m_CurrentOpIdx >= opGroup.CommOps.size()) {
         assert(!m_IsRunning);
         assert(now >= m_CurrentGroupStartTime + opGroup.SyncTime);
-        Trace.RecordEndGroup(now, *this);
+        if (m_Tracer)
+            m_Tracer->RecordEndGroup(now, *this);
         m_CurrentOpIdx = 0;
         ++m_CurrentGroupIdx;
         if (m_CurrentGroupIdx >= CommOpGroups.size()) {
-            Trace.RecordEndStep(now, *this);
+            if (m_Tracer)
+                m_Tracer->RecordEndStep(now, *this);
             m_CurrentGroupIdx = 0;
             ++m_CurrentStepIdx;
             if (StepCount && m_CurrentStepIdx >= *StepCount) {
-                Trace.RecordEndJob(now, *this);
+                if (m_Tracer)
+                    m_Tracer->RecordEndJob(now, *this);
                 m_IsFinished = true;
                 m_FinishTime = now;
                 return true;
             }
-            Trace.RecordBeginStep(now, *this);
+            if (m_Tracer)
+                m_Tracer->RecordBeginStep(now, *this);
         }
-        Trace.RecordBeginGroup(now, *this);
+        if (m_Tracer)
+            m_Tracer->RecordBeginGroup(now, *this);
         m_CurrentGroupStartTime = now;
         return false;
     }
     const auto &op = opGroup.CommOps[m_CurrentOpIdx];
     if (m_IsRunning) {
         assert(now == m_CurrentTransmissionStartTime + m_CurrentTransmissionDuration);
-        Trace.RecordEndTransmission(now, *this);
+        if (m_Tracer)
+            m_Tracer->RecordEndTransmission(now, *this);
         m_IsRunning = false;
         m_CurrentOpTransmittedMessageSize += m_TransmittingMessageSize;
         assert(m_CurrentOpTransmittedMessageSize <= op.MessageSize);
         if (m_CurrentOpTransmittedMessageSize == op.MessageSize) {
-            Trace.RecordEndCommOp(now, *this);
+            if (m_Tracer)
+                m_Tracer->RecordEndCommOp(now, *this);
             m_CurrentOpTransmittedMessageSize = 0;
             ++m_CurrentOpIdx;
         }
@@ -99,16 +163,19 @@ bool Job::RunNextEvent(double now) {
         }
         return false;
     }
-    if (m_CurrentOpTransmittedMessageSize == 0 && now != m_WaitingUntilTime)
-        Trace.RecordBeginCommOp(now, *this);
+    if (m_Tracer && m_CurrentOpTransmittedMessageSize == 0 && now != m_WaitingUntilTime)
+        m_Tracer->RecordBeginCommOp(now, *this);
     auto scheduleRes = m_BeforeTransmissionCallback(*this, now);
     if (scheduleRes.InsertWaitingTime) {
-        Trace.RecordBeginWaiting(now, *this);
+        // Waiting again right after waiting continues the same waiting event
+        if (m_Tracer && now != m_WaitingUntilTime)
+            m_Tracer->RecordBeginWaiting(now, *this);
         m_WaitingUntilTime = now + scheduleRes.WaitingTime;
         return false;
     }
     if (now == m_WaitingUntilTime) {
-        Trace.RecordEndWaiting(now, *this);
+        if (m_Tracer)
+            m_Tracer->RecordEndWaiting(now, *this);
         m_WaitingUntilTime = 0.0;
     }
     assert(!scheduleRes.UseSharp || m_AggrTree);
@@ -119,12 +186,145 @@ bool Job::RunNextEvent(double now) {
         m_TransmittingMessageSize = op.MessageSize - m_CurrentOpTransmittedMessageSize;
     assert(m_CurrentOpTransmittedMessageSize + m_TransmittingMessageSize <= op.MessageSize);
     m_CurrentTransmissionDuration =
-        CalcTransmissionDuration(op.OpType, m_TransmittingMessageSize, m_IsUsingSharp, HostCount);
+        CalcTransmissionDuration(m_CurrentGroupIdx, m_CurrentOpIdx, m_TransmittingMessageSize, m_IsUsingSharp);
     m_CurrentTransmissionStartTime = now;
-    Trace.RecordBeginTransmission(now, *this);
+    if (m_Tracer)
+        m_Tracer->RecordBeginTransmission(now, *this);
     return false;
 }
 
+Job::FastForwardProgress Job::GetFastForwardProgress() const {
+    return {m_FastForwardLastEventTime,
+            m_CurrentStepIdx,
+            m_CurrentGroupIdx,
+            m_CurrentOpIdx,
+            m_FastForwardScheduleIdx,
+            m_IsRunning,
+            m_IsUsingSharp,
+            m_IsFinished,
+            m_CurrentGroupStartTime,
+            m_CurrentTransmissionStartTime,
+            m_CurrentTransmissionDuration,
+            m_DurationWithSharp,
+            m_DurationWithoutSharp};
+}
+
+void Job::SetFastForwardProgress(const FastForwardProgress &progress) {
+    m_FastForwardLastEventTime = progress.LastEventTime;
+    m_FastForwardScheduleIdx = progress.ScheduleIdx;
+    m_CurrentStepIdx = progress.StepIdx;
+    m_CurrentGroupIdx = progress.GroupIdx;
+    m_CurrentOpIdx = progress.OpIdx;
+    m_IsRunning = progress.IsRunning;
+    m_IsUsingSharp = progress.IsUsingSharp;
+    m_CurrentGroupStartTime = progress.GroupStartTime;
+    m_CurrentTransmissionStartTime = progress.TransmissionStartTime;
+    m_CurrentTransmissionDuration = progress.TransmissionDuration;
+    m_DurationWithSharp = progress.DurationWithSharp;
+    m_DurationWithoutSharp = progress.DurationWithoutSharp;
+    if (m_IsRunning)
+        m_TransmittingMessageSize = CommOpGroups[m_CurrentGroupIdx].CommOps[m_CurrentOpIdx].MessageSize;
+    if (progress.IsFinished) {
+        m_IsFinished = true;
+        m_FinishTime = progress.LastEventTime;
+    }
+}
+
+double Job::GetNextEvent(const FastForwardProgress &progress) const {
+    const auto &opGroup = CommOpGroups[progress.GroupIdx];
+    if (progress.OpIdx >= opGroup.CommOps.size())
+        return std::max(progress.LastEventTime, progress.GroupStartTime + opGroup.SyncTime);
+    if (progress.IsRunning)
+        return progress.TransmissionStartTime + progress.TransmissionDuration;
+    const auto &op = opGroup.CommOps[progress.OpIdx];
+    return std::max(progress.LastEventTime,
+                    std::max(m_WaitingUntilTime, progress.GroupStartTime + op.StartTimeInGroup));
+}
+
+void Job::RunNextEvent(FastForwardProgress &progress, double now) const {
+    assert(!progress.IsFinished);
+    progress.LastEventTime = now;
+    const auto &opGroup = CommOpGroups[progress.GroupIdx];
+    if (progress.OpIdx >= opGroup.CommOps.size()) {
+        progress.OpIdx = 0;
+        ++progress.GroupIdx;
+        if (progress.GroupIdx >= CommOpGroups.size()) {
+            progress.GroupIdx = 0;
+            ++progress.StepIdx;
+            if (StepCount && progress.StepIdx >= *StepCount) {
+                progress.IsFinished = true;
+                return;
+            }
+        }
+        progress.GroupStartTime = now;
+        return;
+    }
+    if (progress.IsRunning) {
+        progress.IsRunning = false;
+        ++progress.OpIdx;
+        (progress.IsUsingSharp ? progress.DurationWithSharp : progress.DurationWithoutSharp) +=
+            progress.TransmissionDuration;
+        return;
+    }
+    progress.IsRunning = true;
+    progress.IsUsingSharp = m_FastForwardSchedule[progress.ScheduleIdx];
+    progress.ScheduleIdx = (progress.ScheduleIdx + 1) % m_FastForwardSchedule.size();
+    progress.TransmissionDuration = GetOpDuration(progress.GroupIdx, progress.OpIdx, progress.IsUsingSharp);
+    progress.TransmissionStartTime = now;
+}
+
+bool Job::CanFastForward(double now, std::optional<double> maxTime) const {
+    if (!m_IsStarted || m_IsFinished || m_IsFastForwarding || (!StepCount && !maxTime) || m_NextAggrTree ||
+        m_CurrentOpTransmittedMessageSize > 0 || m_WaitingUntilTime > now)
+        return false;
+    const auto &opGroup = CommOpGroups[m_CurrentGroupIdx];
+    return !m_IsRunning || m_TransmittingMessageSize == opGroup.CommOps[m_CurrentOpIdx].MessageSize;
+}
+
+double Job::RunToVisibleEvent(FastForwardProgress &progress) const {
+    double eventTime;
+    while (true) {
+        eventTime = GetNextEvent(progress);
+        auto stepIdx = progress.StepIdx;
+        RunNextEvent(progress, eventTime);
+        if (progress.IsFinished || (m_FastForwardMaxTime && eventTime > *m_FastForwardMaxTime))
+            break;
+        if (m_FastForwardStopBeforeLastStep && progress.StepIdx != stepIdx && progress.StepIdx + 1 >= *StepCount)
+            break;
+    }
+    return eventTime;
+}
+
+void Job::StartFastForward(double now, std::vector<bool> &&schedule, std::optional<double> maxTime,
+                           bool stopBeforeLastStep) {
+    assert(CanFastForward(now, maxTime));
+    assert(!schedule.empty());
+    assert(m_AggrTree || std::find(schedule.cbegin(), schedule.cend(), true) == schedule.cend());
+    assert(!stopBeforeLastStep || !StepCount || m_CurrentStepIdx + 1 < *StepCount);
+    m_IsFastForwarding = true;
+    m_FastForwardSchedule = std::move(schedule);
+    m_FastForwardScheduleIdx = 0;
+    m_FastForwardMaxTime = maxTime;
+    m_FastForwardStopBeforeLastStep = stopBeforeLastStep && StepCount;
+    m_FastForwardLastEventTime = now;
+    // The events are computed exactly as they would run, so the order of the visible event is kept
+    auto progress = GetFastForwardProgress();
+    m_FastForwardEventTime = RunToVisibleEvent(progress);
+}
+
+void Job::FastForward(double time, bool inclusive) {
+    assert(m_IsFastForwarding);
+    auto progress = GetFastForwardProgress();
+    while (true) {
+        auto eventTime = GetNextEvent(progress);
+        if (eventTime > time || (eventTime == time && !inclusive))
+            break;
+        RunNextEvent(progress, eventTime);
+        assert(!progress.IsFinished);
+    }
+    SetFastForwardProgress(progress);
+}
+
 std::optional<CommOpRunningInfo> Job::GetNextCommOpInfo(double now) const {
     if (m_IsFinished)
         return std::nullopt;
@@ -158,27 +358,19 @@ std::optional<CommOpRunningInfo> Job::GetNextCommOpInfo(double now) const {
     }
     const auto &op = CommOpGroups[groupIdx].CommOps[opIdx];
     auto startTime = std::max(now, std::max(m_WaitingUntilTime, groupStartTime + op.StartTimeInGroup));
-    auto durationWithSharp =
-        CalcTransmissionDuration(op.OpType, op.MessageSize - opTransmittedMessageSize, true, HostCount);
+    auto durationWithSharp = CalcTransmissionDuration(groupIdx, opIdx, op.MessageSize - opTransmittedMessageSize, true);
     auto durationWithoutSharp =
-        CalcTransmissionDuration(op.OpType, op.MessageSize - opTransmittedMessageSize, false, HostCount);
+        CalcTransmissionDuration(groupIdx, opIdx, op.MessageSize - opTransmittedMessageSize, false);
     return CommOpRunningInfo{groupStartTime, startTime, durationWithSharp, durationWithoutSharp, groupIdx, opIdx};
 }
 
 double Job::GetNextCommOpPriority(const CommOpRunningInfo &commOpInfo) const {
-    auto calcGroupFinishTime = [this, &commOpInfo](bool useSharpOnNext, bool useSharpOnRest) -> double {
-        const auto &opGroup = CommOpGroups[commOpInfo.GroupIdx];
-        auto now =
-            commOpInfo.OpStartTime + (useSharpOnNext ? commOpInfo.DurationWithSharp : commOpInfo.DurationWithoutSharp);
-        for (unsigned int opIdx = commOpInfo.OpIdx + 1; opIdx < opGroup.CommOps.size(); ++opIdx) {
-            const auto &op = opGroup.CommOps[opIdx];
-            auto duration = CalcTransmissionDuration(op.OpType, op.MessageSize, useSharpOnRest, HostCount);
-            now = std::max(now, commOpInfo.GroupStartTime + op.StartTimeInGroup) + duration;
-        }
-        return std::max(now, commOpInfo.GroupStartTime + opGroup.SyncTime);
-    };
-    auto nonSharp = calcGroupFinishTime(false, false);
-    auto useSharp = calcGroupFinishTime(true, false);
+    auto idx = m_DurationTable->GroupOffsets[commOpInfo.GroupIdx] + commOpInfo.OpIdx;
+    auto restDuration = m_DurationTable->RestDurations[idx];
+    auto restFinishTime = m_DurationTable->RestFinishTimes[idx];
+    auto opStartTime = commOpInfo.OpStartTime - commOpInfo.GroupStartTime;
+    auto nonSharp = std::max(opStartTime + commOpInfo.DurationWithoutSharp + restDuration, restFinishTime);
+    auto useSharp = std::max(opStartTime + commOpInfo.DurationWithSharp + restDuration, restFinishTime);
     return (nonSharp - useSharp) * HostCount;
 }
 
@@ -189,6 +381,13 @@ void Job::SetHosts(std::vector<const FatTree::Node *> &&hosts) {
 }
 
 void Job::SetNextAggrTree(std::optional<FatTree::AggrTree> &&aggrTree) {
+    if (aggrTree != GetNextAggrTree()) {
+        ++m_NextAggrTreeVersion;
+        // The events of a fast-forwarding job were computed with its current tree, it is up to date by now
+        m_IsFastForwarding = false;
+    } else if (m_IsFastForwarding)
+        // Nothing changes, and a fast-forwarding job does not keep a pending tree
+        return;
     if (m_IsRunning && m_IsUsingSharp)
         m_NextAggrTree = std::move(aggrTree);
     else
@@ -1,11 +1,15 @@
 #pragma once
 
 #include "fat_tree.hpp"
-#include <atomic>
 #include <functional>
+#include <limits>
+#include <memory>
 #include <optional>
 #include <vector>
 
+class SimulationContext;
+class Tracer;
+
 struct CommOp {
     enum class Type {
         AllReduce,
@@ -24,6 +28,14 @@ struct CommOpGroup {
     double SyncTime;
 };
 
+// The immutable definition of a model, interned by ModelInfoProvider and shared by all jobs of the model
+struct ModelInfo {
+    // Dense, in the order the models are first requested
+    const unsigned int ID;
+    const std::string_view Name;
+    const std::vector<CommOpGroup> CommOpGroups;
+};
+
 struct CommOpScheduleResult {
     bool InsertWaitingTime;
     double WaitingTime;
@@ -35,6 +47,19 @@ struct CommOpScheduleResult {
         : InsertWaitingTime(false), UseSharp(useSharp), MessageSize(messageSize) {}
 };
 
+// The durations of transmitting whole CommOps, shared by all jobs of the same model and # of hosts in a context
+struct TransmissionDurationTable {
+    // Group index -> index of its first CommOp in the durations
+    std::vector<unsigned int> GroupOffsets;
+    std::vector<double> DurationsWithSharp;
+    std::vector<double> DurationsWithoutSharp;
+    // If CommOp i finishes at t since the start of its group, and the rest CommOps do not use SHARP, the group finishes
+    // at max(t + RestDurations[i], RestFinishTimes[i]) since its start. This is the max-plus composition of
+    // t -> max(t, StartTimeInGroup) + duration of the rest CommOps, and the SyncTime.
+    std::vector<double> RestDurations;
+    std::vector<double> RestFinishTimes;
+};
+
 struct CommOpRunningInfo {
     double GroupStartTime;
     double OpStartTime;
@@ -45,13 +70,16 @@ struct CommOpRunningInfo {
 };
 
 class Job {
-private:
-    inline static std::atomic<unsigned int> m_NextID = 0;
+public:
+    using TransmissionDurationCalculator = std::function<double(CommOp::Type, unsigned long long, bool, unsigned int)>;
 
+private:
     // Given the job and the current time, returns CommOpScheduleResult.
     std::function<CommOpScheduleResult(const Job &, double)> m_BeforeTransmissionCallback;
     // Given the job and the current time, returns nothing.
     std::function<void(const Job &, double)> m_AfterTransmissionCallback = [](const Job &, double) {};
+    // nullptr if tracing is disabled
+    Tracer *m_Tracer = nullptr;
 
     unsigned int m_CurrentStepIdx = 0;
     unsigned int m_CurrentGroupIdx = 0;
@@ -59,12 +87,12 @@ private:
     unsigned long long m_CurrentOpTransmittedMessageSize = 0;
     bool m_IsRunning = false;
     double m_WaitingUntilTime = -1.0;
-    unsigned long long m_TransmittingMessageSize;
+    unsigned long long m_TransmittingMessageSize = 0;
     double m_CurrentTransmissionDuration;
 
     double m_CurrentGroupStartTime;
     double m_CurrentTransmissionStartTime;
-    bool m_IsUsingSharp;
+    bool m_IsUsingSharp = false;
 
     bool m_IsStarted = false;
     bool m_IsFinished = false;
@@ -78,29 +106,96 @@ private:
     std::vector<const FatTree::Node *> m_Hosts;
     std::optional<FatTree::AggrTree> m_AggrTree;
     std::optional<std::optional<FatTree::AggrTree>> m_NextAggrTree;
+    // Incremented whenever the next aggregation tree changes
+    unsigned int m_NextAggrTreeVersion = 0;
+
+    std::shared_ptr<const TransmissionDurationTable> m_DurationTable;
+
+    // A fast-forwarding job runs its events by itself, see StartFastForward
+    bool m_IsFastForwarding = false;
+    // Whether each transmission uses SHARP, repeated cyclically
+    std::vector<bool> m_FastForwardSchedule;
+    unsigned int m_FastForwardScheduleIdx;
+    std::optional<double> m_FastForwardMaxTime;
+    bool m_FastForwardStopBeforeLastStep;
+    double m_FastForwardLastEventTime;
+    // The time of the only event visible to others, see StartFastForward
+    double m_FastForwardEventTime;
+
+    // The part of the state that changes while fast-forwarding
+    struct FastForwardProgress {
+        double LastEventTime;
+        unsigned int StepIdx, GroupIdx, OpIdx, ScheduleIdx;
+        bool IsRunning, IsUsingSharp, IsFinished;
+        double GroupStartTime, TransmissionStartTime, TransmissionDuration;
+        double DurationWithSharp, DurationWithoutSharp;
+    };
 
+    static std::shared_ptr<const TransmissionDurationTable> GetDurationTable(SimulationContext &context,
+                                                                            const ModelInfo &model,
+                                                                            unsigned int hostCount);
+    // Returns the duration of transmitting the whole CommOp, without calling the calculator.
+    double GetOpDuration(unsigned int groupIdx, unsigned int opIdx, bool useSharp) const {
+        auto idx = m_DurationTable->GroupOffsets[groupIdx] + opIdx;
+        return useSharp ? m_DurationTable->DurationsWithSharp[idx] : m_DurationTable->DurationsWithoutSharp[idx];
+    }
+    // Returns the duration of transmitting the given part of the CommOp.
+    double CalcTransmissionDuration(unsigned int groupIdx, unsigned int opIdx, unsigned long long messageSize,
+                                    bool useSharp) const;
     double CalcStepDuration(bool useSharp) const;
+    FastForwardProgress GetFastForwardProgress() const;
+    void SetFastForwardProgress(const FastForwardProgress &progress);
+    // Same as GetNextEvent and RunNextEvent, but without calling the callbacks or tracing.
+    double GetNextEvent(const FastForwardProgress &progress) const;
+    void RunNextEvent(FastForwardProgress &progress, double now) const;
+    // Run the events up to the one visible to others, returns its time.
+    double RunToVisibleEvent(FastForwardProgress &progress) const;
 
 public:
-    // Given CommOp type, message size, whether to use SHARP, and # of hosts, returns the duration of CommOp in seconds.
-    inline static std::function<double(CommOp::Type, unsigned long long, bool, unsigned int)> CalcTransmissionDuration;
-
+    // Must outlive the job
+    SimulationContext &Context;
+    // Unique in the context
     const unsigned int ID;
+    const ModelInfo &Model;
     const std::string_view ModelName;
     const unsigned int HostCount;
     const std::optional<unsigned int> StepCount;
-    const std::vector<CommOpGroup> CommOpGroups;
+    // When the job is submitted, in second. It waits in the pending queue of AllocationController until admitted.
+    const double ArrivalTime;
+    const std::vector<CommOpGroup> &CommOpGroups;
 
     double StepDurationWithSharp;
     double StepDurationWithoutSharp;
 
-    explicit Job(std::string_view modelName, unsigned int hostCount, std::optional<unsigned int> stepCount);
+    explicit Job(SimulationContext &context, std::string_view modelName, unsigned int hostCount,
+                 std::optional<unsigned int> stepCount, double arrivalTime = 0.0);
 
-    // Returns the time of the next event.
+    // Returns the time of the next event. For a fast-forwarding job, this is the event visible to others.
     double GetNextEvent(double now) const;
-    // Returns whether the job is finished.
+    // Returns whether the job is finished. A fast-forwarding job runs up to the event visible to others, and stops
+    // fast-forwarding.
     bool RunNextEvent(double now);
 
+    // Returns whether the job transmits whole CommOps without waiting, and will finish or stop at maxTime, so it can
+    // start fast-forwarding.
+    bool CanFastForward(double now, std::optional<double> maxTime) const;
+    // Once the schedule of a job is known in advance, e.g. it is alone in its sharing group without contention for its
+    // aggregation tree, it runs the same way whatever the rest of the cluster does. Such a job can be fast-forwarded:
+    // it runs its events by itself, following the schedule for whether each transmission uses SHARP, without calling
+    // the callbacks. Its state is only brought up to date by FastForward, so the caller is responsible for the
+    // resources of its transmissions. Must be called right after an event at now. The only event visible to others is
+    // when the job finishes, its first event after maxTime if given, or when it begins its last step if
+    // stopBeforeLastStep.
+    void StartFastForward(double now, std::vector<bool> &&schedule, std::optional<double> maxTime,
+                          bool stopBeforeLastStep);
+    // Run the events before the given time, or also at the given time if inclusive, which must be before the event
+    // visible to others.
+    void FastForward(double time, bool inclusive);
+    void StopFastForward() { m_IsFastForwarding = false; }
+    bool IsFastForwarding() const { return m_IsFastForwarding; }
+    // Returns whether the current aggregation tree is in use and will be replaced by a different one.
+    bool IsMigratingAggrTree() const { return m_NextAggrTree && *m_NextAggrTree != m_AggrTree; }
+
     std::optional<CommOpRunningInfo> GetNextCommOpInfo(double now) const;
     double GetNextCommOpPriority(const CommOpRunningInfo &commOpInfo) const;
 
@@ -118,6 +213,11 @@ public:
     double GetFinishTime() const { return m_FinishTime; }
     double GetDurationWithSharp() const { return m_DurationWithSharp; }
     double GetDurationWithoutSharp() const { return m_DurationWithoutSharp; }
+    // The duration of the job if no transmission uses SHARP, infinity without a step count. Used by the schedulers to
+    // estimate the runtimes.
+    double GetEstimatedDuration() const {
+        return StepCount ? StepDurationWithoutSharp * *StepCount : std::numeric_limits<double>::infinity();
+    }
     unsigned int GetTreeMigrationCount() const { return m_TreeMigrationCount; }
     unsigned int GetConsensusCount() const { return m_ConsensusCount; }
     const std::vector<const FatTree::Node *> &GetHosts() const { return m_Hosts; }
@@ -125,6 +225,7 @@ public:
     const std::optional<FatTree::AggrTree> &GetNextAggrTree() const {
         return m_NextAggrTree ? *m_NextAggrTree : m_AggrTree;
     }
+    unsigned int GetNextAggrTreeVersion() const { return m_NextAggrTreeVersion; }
 
     void SetBeforeTransmissionCallback(const decltype(m_BeforeTransmissionCallback) &callback) {
         m_BeforeTransmissionCallback = callback;
@@ -132,6 +233,7 @@ public:
     void SetAfterTransmissionCallback(const decltype(m_AfterTransmissionCallback) &callback) {
         m_AfterTransmissionCallback = callback;
     }
+    void SetTracer(Tracer *tracer) { m_Tracer = tracer; }
     void SetHosts(std::vector<const FatTree::Node *> &&hosts);
     void SetNextAggrTree(std::optional<FatTree::AggrTree> &&aggrTree);
     void IncrementConsensusCount() { ++m_ConsensusCount; }
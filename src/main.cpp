@@ -1,6 +1,19 @@
 #include "experiments/experiments.hpp"
 
 int main(int argc, const char *argv[]) {
+    if (argc == 4 && std::string(argv[1]) == "convert-trace") {
+        if (!Tracer::ConvertToChromeTrace(argv[2], argv[3])) {
+            std::cerr << "Invalid trace file!\n";
+            return 1;
+        }
+        return 0;
+    }
+    if (argc == 3 && std::string(argv[1]) == "sweep")
+        return RunSweep(argv[2]) ? 0 : 1;
+    if (argc == 4 && std::string(argv[1]) == "sweep-worker")
+        return RunSweepWorker(argv[2], argv[3]) ? 0 : 1;
+    if (argc == 4 && std::string(argv[1]) == "sweep-reduce")
+        return ReduceSweep(argv[2], argv[3]) ? 0 : 1;
     if (argc != 2) {
         std::cerr << "Please specify the experiment name to run!\n";
         return 1;
@@ -0,0 +1,24 @@
+#include "pending_job_queue.hpp"
+#include <cassert>
+
+void PendingJobQueue::Push(std::unique_ptr<Job> &&job) {
+    auto jobID = job->ID;
+    assert(m_Jobs.empty() || m_Jobs.rbegin()->first < jobID);
+    m_JobsByEstimatedDuration.emplace(job->GetEstimatedDuration(), jobID, job.get());
+    m_Jobs.emplace_hint(m_Jobs.end(), jobID, std::move(job));
+}
+
+std::unique_ptr<Job> PendingJobQueue::Take(const Job &job) {
+    auto iter = m_Jobs.find(job.ID);
+    assert(iter != m_Jobs.end() && iter->second);
+    m_TakenJobs.emplace_back(job.GetEstimatedDuration(), job.ID, &job);
+    return std::move(iter->second);
+}
+
+void PendingJobQueue::RemoveTaken() {
+    for (const auto &key : m_TakenJobs) {
+        m_Jobs.erase(std::get<1>(key));
+        m_JobsByEstimatedDuration.erase(key);
+    }
+    m_TakenJobs.clear();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "job.hpp"
+#include <map>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <vector>
+
+// The arrived jobs waiting for hosts, kept both in the order of arrival and in the order of estimated duration, see
+// Job::GetEstimatedDuration, so that scheduling policies never sort them. A job taken out stays in both orders, as
+// nullptr in GetJobs, until RemoveTaken, so that taking jobs does not disturb the iterations of a scheduling policy.
+class PendingJobQueue {
+private:
+    using DurationKey = std::tuple<double, unsigned int, const Job *>;
+
+    // Job ID -> job, job IDs increase in the order of arrival
+    std::map<unsigned int, std::unique_ptr<Job>> m_Jobs;
+    // (estimated duration, job ID, job), ties are broken by the order of arrival
+    std::set<DurationKey> m_JobsByEstimatedDuration;
+    std::vector<DurationKey> m_TakenJobs;
+
+public:
+    void Push(std::unique_ptr<Job> &&job);
+    std::unique_ptr<Job> Take(const Job &job);
+    void RemoveTaken();
+
+    bool Empty() const { return m_Jobs.empty(); }
+    unsigned int Size() const { return m_Jobs.size(); }
+    const std::map<unsigned int, std::unique_ptr<Job>> &GetJobs() const { return m_Jobs; }
+    const std::set<DurationKey> &GetJobsByEstimatedDuration() const { return m_JobsByEstimatedDuration; }
+};
@@ -0,0 +1,53 @@
+#include "easy_backfilling.hpp"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+void EasyBackfillingSchedulingPolicy::operator()(const FatTreeResource &resources,
+                                                 const std::vector<std::unique_ptr<Job>> &runningJobs,
+                                                 const PendingJobQueue &pendingJobs, double now,
+                                                 const std::function<bool(const Job &)> &tryAdmit) const {
+    const auto &jobs = pendingJobs.GetJobs();
+    auto head = jobs.begin();
+    while (head != jobs.end() && tryAdmit(*head->second))
+        ++head;
+    if (head == jobs.end())
+        return;
+    const auto &headJob = *head->second;
+    auto freeHostCount = resources.GetFreeHostCount();
+    // (estimated finish time, # of hosts) of the running jobs, a job running longer than estimated may finish any time.
+    // The jobs admitted just now have not started yet.
+    std::vector<std::pair<double, unsigned int>> finishes;
+    finishes.reserve(runningJobs.size());
+    for (const auto &job : runningJobs) {
+        auto startTime = job->IsStarted() ? job->GetStartTime() : now;
+        finishes.emplace_back(std::max(now, startTime + job->GetEstimatedDuration()), job->HostCount);
+    }
+    std::sort(finishes.begin(), finishes.end());
+    double shadowTime = now;
+    unsigned int shadowHostCount = freeHostCount;
+    for (auto [finishTime, jobHostCount] : finishes) {
+        if (shadowHostCount >= headJob.HostCount)
+            break;
+        shadowHostCount += jobHostCount;
+        shadowTime = finishTime;
+    }
+    // The first job may never fit, e.g. if it is larger than the cluster
+    if (shadowHostCount < headJob.HostCount)
+        shadowTime = std::numeric_limits<double>::infinity();
+    auto extraHostCount = shadowHostCount >= headJob.HostCount ? shadowHostCount - headJob.HostCount : 0;
+    for (auto iter = std::next(head); iter != jobs.end() && freeHostCount > 0; ++iter) {
+        const auto &job = *iter->second;
+        if (job.HostCount > freeHostCount)
+            continue;
+        bool finishesBeforeShadow = now + job.GetEstimatedDuration() <= shadowTime;
+        if (!finishesBeforeShadow && job.HostCount > extraHostCount)
+            continue;
+        if (!tryAdmit(job))
+            continue;
+        freeHostCount -= job.HostCount;
+        if (!finishesBeforeShadow)
+            extraHostCount -= job.HostCount;
+    }
+}
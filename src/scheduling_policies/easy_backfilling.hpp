@@ -0,0 +1,20 @@
+#pragma once
+
+#include "fat_tree_resource.hpp"
+#include "job.hpp"
+#include "pending_job_queue.hpp"
+#include <functional>
+#include <memory>
+#include <vector>
+
+// EASY backfilling: admits the pending jobs in the order of arrival. Once the first of them cannot get hosts, it
+// reserves the hosts for it at the earliest time enough running jobs are estimated to finish (the shadow time), and
+// admits any later job that fits now without delaying the reservation: it either finishes before the shadow time, or
+// only takes the hosts the first job will not need then. Durations are estimated with Job::GetEstimatedDuration, and
+// hosts are counted regardless of where they are.
+class EasyBackfillingSchedulingPolicy {
+public:
+    void operator()(const FatTreeResource &resources, const std::vector<std::unique_ptr<Job>> &runningJobs,
+                    const PendingJobQueue &pendingJobs, double now,
+                    const std::function<bool(const Job &)> &tryAdmit) const;
+};
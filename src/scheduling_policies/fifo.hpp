@@ -0,0 +1,20 @@
+#pragma once
+
+#include "fat_tree_resource.hpp"
+#include "job.hpp"
+#include "pending_job_queue.hpp"
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Admits the pending jobs in the order of arrival, until one cannot get hosts.
+class FIFOSchedulingPolicy {
+public:
+    void operator()(const FatTreeResource &, const std::vector<std::unique_ptr<Job>> &,
+                    const PendingJobQueue &pendingJobs, double,
+                    const std::function<bool(const Job &)> &tryAdmit) const {
+        for (const auto &[jobID, job] : pendingJobs.GetJobs())
+            if (!tryAdmit(*job))
+                return;
+    }
+};
@@ -0,0 +1,9 @@
+#include "shortest_job_first.hpp"
+
+void ShortestJobFirstSchedulingPolicy::operator()(const FatTreeResource &, const std::vector<std::unique_ptr<Job>> &,
+                                                  const PendingJobQueue &pendingJobs, double,
+                                                  const std::function<bool(const Job &)> &tryAdmit) const {
+    for (const auto &[estimatedDuration, jobID, job] : pendingJobs.GetJobsByEstimatedDuration())
+        if (!tryAdmit(*job))
+            return;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "fat_tree_resource.hpp"
+#include "job.hpp"
+#include "pending_job_queue.hpp"
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Admits the pending jobs in the order of their estimated durations, see Job::GetEstimatedDuration, until one cannot
+// get hosts. Ties are broken by the order of arrival.
+class ShortestJobFirstSchedulingPolicy {
+public:
+    void operator()(const FatTreeResource &resources, const std::vector<std::unique_ptr<Job>> &runningJobs,
+                    const PendingJobQueue &pendingJobs, double now,
+                    const std::function<bool(const Job &)> &tryAdmit) const;
+};
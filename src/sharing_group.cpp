@@ -1,57 +1,64 @@
 #include "sharing_group.hpp"
+#include "simulation_context.hpp"
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 
 SharingGroup::SharingGroup(std::vector<Job *> &&jobs, FatTreeResource *resources,
                            const decltype(m_SharingPolicy) &sharingPolicy)
-    : m_Resources(resources), m_SharingPolicy(sharingPolicy), Jobs(std::move(jobs)) {
-    for (auto job : Jobs) {
-        // TODO: Migrating
-        job->SetBeforeTransmissionCallback([this](const Job &job, double now) -> CommOpScheduleResult {
-            std::chrono::high_resolution_clock::time_point startTime, endTime;
-            if (RecordSharingOverhead)
-                startTime = std::chrono::high_resolution_clock::now();
-            auto res = m_SharingPolicy(*this, job, now);
-            if (RecordSharingOverhead) {
-                endTime = std::chrono::high_resolution_clock::now();
-                ++SharingPolicyCallCount;
-                SharingPolicyOverhead +=
-                    std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
-            }
-            if (!res.InsertWaitingTime)
-                m_BeforeTransmissionCallback(job, now, res.UseSharp);
-            if (RecordSharingOverhead && Jobs.size() > 1)
-                for (auto j : Jobs)
-                    j->IncrementConsensusCount();
-            return res;
-        });
-        job->SetAfterTransmissionCallback([this](const Job &job, double now) {
-            m_AfterTransmissionCallback(job, now, job.IsUsingSharp());
-            if (RecordSharingOverhead && Jobs.size() > 1)
-                for (auto j : Jobs)
-                    j->IncrementConsensusCount();
-        });
-    }
+    : m_Resources(resources), m_SharingPolicy(sharingPolicy), m_Jobs(std::move(jobs)) {
+    std::sort(m_Jobs.begin(), m_Jobs.end(), [](const Job *job1, const Job *job2) { return job1->ID < job2->ID; });
+    for (auto job : m_Jobs)
+        InstallCallbacks(job);
 }
 
-std::pair<double, Job *> SharingGroup::GetNextEvent(double now) const {
-    double nearestEventTime;
-    Job *nearestJob = nullptr;
-    for (auto job : Jobs) {
-        auto nextEventTime = job->GetNextEvent(now);
-        if (!nearestJob || nextEventTime < nearestEventTime) {
-            nearestEventTime = nextEventTime;
-            nearestJob = job;
+void SharingGroup::InstallCallbacks(Job *job) {
+    // TODO: Migrating
+    job->SetBeforeTransmissionCallback([this](const Job &job, double now) -> CommOpScheduleResult {
+        auto &context = job.Context;
+        std::chrono::high_resolution_clock::time_point startTime, endTime;
+        if (context.RecordSharingOverhead)
+            startTime = std::chrono::high_resolution_clock::now();
+        auto res = m_SharingPolicy(*this, job, now);
+        if (context.RecordSharingOverhead) {
+            endTime = std::chrono::high_resolution_clock::now();
+            ++context.SharingPolicyCallCount;
+            context.SharingPolicyOverhead +=
+                std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
         }
-    }
-    assert(nearestJob);
-    return {nearestEventTime, nearestJob};
+        if (!res.InsertWaitingTime)
+            m_BeforeTransmissionCallback(job, now, res.UseSharp);
+        if (context.RecordSharingOverhead && m_Jobs.size() > 1)
+            for (auto j : m_Jobs)
+                j->IncrementConsensusCount();
+        return res;
+    });
+    job->SetAfterTransmissionCallback([this](const Job &job, double now) {
+        m_AfterTransmissionCallback(job, now, job.IsUsingSharp());
+        if (job.Context.RecordSharingOverhead && m_Jobs.size() > 1)
+            for (auto j : m_Jobs)
+                j->IncrementConsensusCount();
+    });
+}
+
+void SharingGroup::AddJob(Job *job) {
+    assert(std::find(m_Jobs.cbegin(), m_Jobs.cend(), job) == m_Jobs.cend());
+    auto iter = std::upper_bound(m_Jobs.cbegin(), m_Jobs.cend(), job,
+                                 [](const Job *job1, const Job *job2) { return job1->ID < job2->ID; });
+    m_Jobs.insert(iter, job);
+    InstallCallbacks(job);
+}
+
+void SharingGroup::RemoveJob(Job *job) {
+    auto iter = std::find(m_Jobs.cbegin(), m_Jobs.cend(), job);
+    assert(iter != m_Jobs.cend());
+    m_Jobs.erase(iter);
 }
 
 bool SharingGroup::CanUseSharp(const Job &job) const {
     assert(!job.IsFinished());
     assert(!job.IsRunning());
-    for (auto j : Jobs)
+    for (auto j : m_Jobs)
         if (j->IsRunning() && j->IsUsingSharp())
             return false;
     const auto &aggrTree = job.GetCurrentAggrTree();
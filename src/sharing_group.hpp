@@ -16,18 +16,21 @@ private:
     // Given the sharing group, the job, and the current time, returns CommOpScheduleResult.
     std::function<CommOpScheduleResult(const SharingGroup &, const Job &, double)> m_SharingPolicy;
 
-public:
-    inline static bool RecordSharingOverhead = false;
-    inline static unsigned int SharingPolicyCallCount = 0;
-    inline static unsigned long long SharingPolicyOverhead = 0; // In nanosecond
+    // In the order of job IDs, which the sharing policies break ties by
+    std::vector<Job *> m_Jobs;
 
-    const std::vector<Job *> Jobs;
+    void InstallCallbacks(Job *job);
 
+public:
     explicit SharingGroup(std::vector<Job *> &&jobs, FatTreeResource *resources,
                           const decltype(m_SharingPolicy) &sharingPolicy);
 
-    // Returns the time of the next event and the job that will run next.
-    std::pair<double, Job *> GetNextEvent(double now) const;
+    const std::vector<Job *> &GetJobs() const { return m_Jobs; }
+    // Add the job to this group and route its transmission callbacks through this group.
+    void AddJob(Job *job);
+    // Remove the job from this group. The callbacks of the job are left as is until it is added to another group.
+    void RemoveJob(Job *job);
+
     // Returns whether the job is finished.
     bool RunNextEvent(double now, Job *job) { return job->RunNextEvent(now); }
 
@@ -10,7 +10,7 @@ CommOpScheduleResult SmartSharingPolicy::operator()(const SharingGroup &sharingG
     assert(thisOpInfo);
     auto thisPriority = job.GetNextCommOpPriority(*thisOpInfo);
     auto thisRatio = thisPriority / (thisOpInfo->OpStartTime + thisOpInfo->DurationWithSharp - now);
-    for (auto otherJob : sharingGroup.Jobs) {
+    for (auto otherJob : sharingGroup.GetJobs()) {
         if (otherJob == &job)
             continue;
         auto otherOpInfo = otherJob->GetNextCommOpInfo(now);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "job.hpp"
+#include "utils/read_mostly_map.hpp"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// Parameters of SmartTreeBuildingPolicy
+struct SmartTreeBuildingParams {
+    // The number of steps to simulate a sharing group for
+    unsigned int SimulationStepCount = 3;
+    // Sharing groups larger than this are never formed
+    unsigned int MaxSharingJobCount = 30;
+    // A merge is skipped if the mean plus Sigma standard deviations of the scores of the groups of the same size does
+    // not improve the score
+    double Sigma = 1;
+    double ScoreMinStd = 0.02;
+    // The number of scores needed before the estimation is used
+    unsigned int MinTrackerCount = 10;
+};
+
+// The parameters of a simulation, and the state shared by all jobs created with them. Simulations with different
+// contexts are independent, so they can run in parallel with different parameters. A context may also be shared by
+// simulations running in parallel, but then the job IDs depend on the interleaving. The parameters must not change once
+// a job is created.
+class SimulationContext {
+    friend class Job;
+
+private:
+    struct DurationTableKeyHash {
+        std::size_t operator()(const std::pair<unsigned int, unsigned int> &key) const {
+            return static_cast<std::size_t>(key.first) * 1000003 + key.second;
+        }
+    };
+
+    std::atomic<unsigned int> m_NextJobID = 0;
+    // (model ID, # of hosts) -> durations, built by the first job that needs them and read without a lock afterwards
+    ReadMostlyMap<std::pair<unsigned int, unsigned int>, std::shared_ptr<const TransmissionDurationTable>,
+                  DurationTableKeyHash>
+        m_DurationTables;
+
+public:
+    // Given CommOp type, message size, whether to use SHARP, and # of hosts, returns the duration of CommOp in seconds.
+    const Job::TransmissionDurationCalculator CalcTransmissionDuration;
+    // The computation time of the models is divided by this ratio
+    double GPUSpeedupRatio = 1.0;
+    SmartTreeBuildingParams SmartTreeBuilding;
+
+    bool RecordSharingOverhead = false;
+    // Only counted if RecordSharingOverhead
+    std::atomic<unsigned int> SharingPolicyCallCount = 0;
+    std::atomic<unsigned long long> SharingPolicyOverhead = 0; // In nanosecond
+
+    explicit SimulationContext(Job::TransmissionDurationCalculator &&calcTransmissionDuration)
+        : CalcTransmissionDuration(std::move(calcTransmissionDuration)) {}
+    SimulationContext(const SimulationContext &) = delete;
+    SimulationContext &operator=(const SimulationContext &) = delete;
+};
@@ -1,33 +1,22 @@
 #include "first.hpp"
 
-void FirstTreeBuildingPolicy::operator()(const FatTreeResource &resources,
-                                         const std::vector<std::unique_ptr<Job>> &jobs,
+void FirstTreeBuildingPolicy::operator()(const FatTreeResource &resources, const std::vector<std::unique_ptr<Job>> &,
                                          const std::vector<Job *> &newJobs) const {
-    std::vector<FatTree::AggrTree> newAggrTrees;
+    // The trees of the running jobs are registered in the resources, the new trees are indexed here
+    FatTreeResource::TreeIndex newAggrTrees(resources);
     for (auto newJob : newJobs)
         for (auto root : resources.Topology->GetClosestCommonAncestors(newJob->GetHosts())) {
             auto currTree = resources.Topology->GetAggregationTree(newJob->GetHosts(), root);
             if (m_CheckConflict) {
                 if (resources.CheckTreeConflict(currTree))
                     continue;
-                bool conflict = false;
-                for (const auto &tree : newAggrTrees)
-                    if (resources.CheckTreeConflict(currTree, tree)) {
-                        conflict = true;
-                        break;
-                    }
-                if (conflict)
+                if (newAggrTrees.HasConflictingTrees(currTree))
                     continue;
-                for (const auto &job : jobs)
-                    if (job->GetNextAggrTree() && resources.CheckTreeConflict(currTree, *job->GetNextAggrTree())) {
-                        conflict = true;
-                        break;
-                    }
-                if (conflict)
+                if (resources.HasConflictingTrees(currTree))
                     continue;
             }
-            newJob->SetNextAggrTree(currTree);
-            newAggrTrees.push_back(std::move(currTree));
+            newAggrTrees.Add(newJob->ID, currTree);
+            newJob->SetNextAggrTree(std::move(currTree));
             break;
         }
 }
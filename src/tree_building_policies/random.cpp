@@ -1,10 +1,9 @@
 #include "random.hpp"
-#include <random>
 
-void RandomTreeBuildingPolicy::operator()(const FatTreeResource &resources,
-                                          const std::vector<std::unique_ptr<Job>> &jobs,
-                                          const std::vector<Job *> &newJobs) const {
-    std::vector<FatTree::AggrTree> newAggrTrees;
+void RandomTreeBuildingPolicy::operator()(const FatTreeResource &resources, const std::vector<std::unique_ptr<Job>> &,
+                                          const std::vector<Job *> &newJobs) {
+    // The trees of the running jobs are registered in the resources, the new trees are indexed here
+    FatTreeResource::TreeIndex newAggrTrees(resources);
     for (auto newJob : newJobs) {
         std::vector<FatTree::AggrTree> availableTrees;
         for (auto root : resources.Topology->GetClosestCommonAncestors(newJob->GetHosts())) {
@@ -12,31 +11,19 @@ void RandomTreeBuildingPolicy::operator()(const FatTreeResource &resources,
             if (m_CheckConflict) {
                 if (resources.CheckTreeConflict(currTree))
                     continue;
-                bool conflict = false;
-                for (const auto &tree : newAggrTrees)
-                    if (resources.CheckTreeConflict(currTree, tree)) {
-                        conflict = true;
-                        break;
-                    }
-                if (conflict)
+                if (newAggrTrees.HasConflictingTrees(currTree))
                     continue;
-                for (const auto &job : jobs)
-                    if (job->GetNextAggrTree() && resources.CheckTreeConflict(currTree, *job->GetNextAggrTree())) {
-                        conflict = true;
-                        break;
-                    }
-                if (conflict)
+                if (resources.HasConflictingTrees(currTree))
                     continue;
             }
             availableTrees.push_back(std::move(currTree));
             break;
         }
         if (!availableTrees.empty()) {
-            thread_local std::default_random_engine engine(42);
             std::uniform_int_distribution<std::size_t> random(0, availableTrees.size() - 1);
-            auto &chosenTree = availableTrees[random(engine)];
-            newJob->SetNextAggrTree(chosenTree);
-            newAggrTrees.push_back(std::move(chosenTree));
+            auto &chosenTree = availableTrees[random(m_Engine)];
+            newAggrTrees.Add(newJob->ID, chosenTree);
+            newJob->SetNextAggrTree(std::move(chosenTree));
         }
     }
 }
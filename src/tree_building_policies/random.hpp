@@ -3,15 +3,18 @@
 #include "fat_tree_resource.hpp"
 #include "job.hpp"
 #include <memory>
+#include <random>
 #include <vector>
 
 class RandomTreeBuildingPolicy {
 private:
     bool m_CheckConflict;
+    // Owned by the policy, so each simulation draws the same sequence on whichever thread it runs
+    std::default_random_engine m_Engine{42};
 
 public:
     explicit RandomTreeBuildingPolicy(bool checkConflict) : m_CheckConflict(checkConflict) {}
 
     void operator()(const FatTreeResource &resources, const std::vector<std::unique_ptr<Job>> &jobs,
-                    const std::vector<Job *> &newJobs) const;
+                    const std::vector<Job *> &newJobs);
 };
@@ -29,21 +29,26 @@ void SmartTreeBuildingPolicy::operator()(const FatTreeResource &resources,
                                          const std::vector<Job *> &newJobs) {
     // Get sub graph from previous conflict graph
     auto start = std::chrono::high_resolution_clock::now();
+    if (!m_TreeIndex)
+        m_TreeIndex.emplace(resources);
     std::unordered_map<unsigned int, Job *> jobIdMap;
     for (auto &job : jobs)
         jobIdMap[job->ID] = job.get();
     std::vector<char> nodeSet(m_ConflictGraph.GetNodeCount(), false);
     std::vector<FatTree::AggrTree> newAggrTrees;
-    std::vector<unsigned int> newTreeIdxToJobId;
+    std::vector<unsigned int> newTreeIdxToJobId, newTreeIdxToTreeId;
     for (unsigned int i = 0; i < nodeSet.size(); ++i)
         if (jobIdMap.count(m_TreeIdxToJobId[i]) > 0) {
             nodeSet[i] = true;
             newAggrTrees.push_back(std::move(m_AggrTrees[i]));
             newTreeIdxToJobId.push_back(m_TreeIdxToJobId[i]);
-        }
+            newTreeIdxToTreeId.push_back(m_TreeIdxToTreeId[i]);
+        } else
+            m_TreeIndex->Remove(m_TreeIdxToTreeId[i]);
     m_ConflictGraph = m_ConflictGraph.GetSubGraph(nodeSet);
     m_AggrTrees = std::move(newAggrTrees);
     m_TreeIdxToJobId = std::move(newTreeIdxToJobId);
+    m_TreeIdxToTreeId = std::move(newTreeIdxToTreeId);
     auto finish = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::microseconds>(finish - start).count();
     if (SHOW_TIME)
@@ -55,13 +60,13 @@ void SmartTreeBuildingPolicy::operator()(const FatTreeResource &resources,
         auto roots = resources.Topology->GetClosestCommonAncestors(newJob->GetHosts());
         std::vector<const FatTree::Node *> chosenRoots;
         if (MaxTreeCount && *MaxTreeCount < roots.size()) {
-            thread_local std::default_random_engine engine(42);
-            std::sample(roots.cbegin(), roots.cend(), std::back_inserter(chosenRoots), *MaxTreeCount, engine);
+            std::sample(roots.cbegin(), roots.cend(), std::back_inserter(chosenRoots), *MaxTreeCount, m_Engine);
         } else
             chosenRoots = std::move(roots);
         for (auto root : chosenRoots) {
             m_AggrTrees.push_back(resources.Topology->GetAggregationTree(newJob->GetHosts(), root));
             m_TreeIdxToJobId.push_back(newJob->ID);
+            m_TreeIdxToTreeId.push_back(m_NextTreeId++);
         }
     }
     finish = std::chrono::high_resolution_clock::now();
@@ -75,11 +80,22 @@ void SmartTreeBuildingPolicy::operator()(const FatTreeResource &resources,
     m_ConflictGraph.SetNodeCount(m_AggrTrees.size());
     for (unsigned int i = oldSize; i < m_ConflictGraph.GetNodeCount(); ++i)
         m_ConflictGraph.SetNodeWeight(i, jobIdMap[m_TreeIdxToJobId[i]]->HostCount);
-    for (unsigned int i = oldSize; i < m_ConflictGraph.GetNodeCount(); ++i)
-        for (unsigned int j = 0; j < i; ++j)
-            if (m_TreeIdxToJobId[i] == m_TreeIdxToJobId[j] ||
-                resources.CheckTreeConflict(m_AggrTrees[i], m_AggrTrees[j]))
-                m_ConflictGraph.AddEdge(i, j, false);
+    std::unordered_map<unsigned int, unsigned int> treeIdToTreeIdx;
+    for (unsigned int i = 0; i < m_TreeIdxToTreeId.size(); ++i)
+        treeIdToTreeIdx[m_TreeIdxToTreeId[i]] = i;
+    for (unsigned int i = oldSize; i < m_ConflictGraph.GetNodeCount(); ++i) {
+        // The index only contains the trees before i, and the trees of the same job are contiguous
+        std::vector<unsigned int> neighbors;
+        for (auto treeId : m_TreeIndex->GetConflictingTrees(m_AggrTrees[i]))
+            neighbors.push_back(treeIdToTreeIdx[treeId]);
+        for (unsigned int j = i; j > oldSize && m_TreeIdxToJobId[j - 1] == m_TreeIdxToJobId[i]; --j)
+            neighbors.push_back(j - 1);
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+        for (auto j : neighbors)
+            m_ConflictGraph.AddEdge(i, j, false);
+        m_TreeIndex->Add(m_TreeIdxToTreeId[i], m_AggrTrees[i]);
+    }
     finish = std::chrono::high_resolution_clock::now();
     duration = std::chrono::duration_cast<std::chrono::microseconds>(finish - start).count();
     if (SHOW_TIME)
@@ -195,10 +211,12 @@ void SmartTreeBuildingPolicy::operator()(const FatTreeResource &resources,
         }
         return res;
     };
-    auto simulateAfterMerge = [this](const std::vector<std::pair<unsigned int, std::string_view>> &jobList) {
+    const auto &params = m_Context.SmartTreeBuilding;
+    auto simulateAfterMerge = [this, &params](const std::vector<std::pair<unsigned int, std::string_view>> &jobList) {
         if (m_SimResCache.count(jobList) > 0)
             return m_SimResCache[jobList];
-        auto res = AllocationController::SimulateSharingGroup(jobList, SmartSharingPolicy(), SimulationStepCount);
+        auto res = AllocationController::SimulateSharingGroup(m_Context, jobList, SmartSharingPolicy(),
+                                                              params.SimulationStepCount);
         m_SimResCache[jobList] = res;
         return res;
     };
@@ -210,13 +228,13 @@ void SmartTreeBuildingPolicy::operator()(const FatTreeResource &resources,
         for (unsigned int i = 0; i < mergeOpportunities.size(); ++i) {
             const auto &[groups, trees] = mergeOpportunities[i];
             auto jobList = getMergedJobInfoList(groups, trees);
-            if (jobList.size() > MaxSharingJobCount)
+            if (jobList.size() > params.MaxSharingJobCount)
                 continue;
             auto scoreBefore = simulateBeforeMerge(groups, trees).JCTScoreWeighted();
             // Estimate the score upper bound
             auto &tracker = m_ScoreTrackers[jobList.size()];
-            if (tracker.Count() >= MinTrackerCount) {
-                auto scoreEstimate = tracker.Mean() + Sigma * std::max(tracker.Std(), ScoreMinStd);
+            if (tracker.Count() >= params.MinTrackerCount) {
+                auto scoreEstimate = tracker.Mean() + params.Sigma * std::max(tracker.Std(), params.ScoreMinStd);
                 if (scoreEstimate - scoreBefore < bestScoreDiff)
                     continue;
             }
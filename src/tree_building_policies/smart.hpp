@@ -3,9 +3,11 @@
 #include "allocation_controller.hpp"
 #include "fat_tree_resource.hpp"
 #include "job.hpp"
+#include "simulation_context.hpp"
 #include "utils/graph.hpp"
 #include "utils/mean_std_tracker.hpp"
 #include <memory>
+#include <random>
 #include <vector>
 
 class SmartTreeBuildingPolicy {
@@ -14,9 +16,17 @@ private:
         std::size_t operator()(const std::vector<std::pair<unsigned int, std::string_view>> &obj) const;
     };
 
+    // Provides the parameters, and the sharing groups are simulated with it
+    SimulationContext &m_Context;
     Graph m_ConflictGraph;
     std::vector<FatTree::AggrTree> m_AggrTrees;
     std::vector<unsigned int> m_TreeIdxToJobId;
+    // Tree indices are compacted on every call, so the trees are identified by a stable ID in the index
+    std::vector<unsigned int> m_TreeIdxToTreeId;
+    unsigned int m_NextTreeId = 0;
+    std::optional<FatTreeResource::TreeIndex> m_TreeIndex;
+    // Samples the roots if MaxTreeCount is set
+    std::default_random_engine m_Engine{42};
 
     // Job count -> tracker
     std::unordered_map<unsigned int, MeanStdTracker> m_ScoreTrackers;
@@ -26,15 +36,10 @@ private:
     unsigned int m_Count = 0;
 
 public:
-    inline static unsigned int SimulationStepCount = 3;
-    inline static unsigned int MaxSharingJobCount = 30;
-    inline static double Sigma = 1;
-    inline static double ScoreMinStd = 0.02;
-    inline static unsigned int MinTrackerCount = 10;
-
     const std::optional<unsigned int> MaxTreeCount;
 
-    explicit SmartTreeBuildingPolicy(std::optional<unsigned int> maxTreeCount) : MaxTreeCount(maxTreeCount) {}
+    explicit SmartTreeBuildingPolicy(SimulationContext &context, std::optional<unsigned int> maxTreeCount)
+        : m_Context(context), MaxTreeCount(maxTreeCount) {}
 
     void operator()(const FatTreeResource &resources, const std::vector<std::unique_ptr<Job>> &jobs,
                     const std::vector<Job *> &newJobs);
@@ -0,0 +1,33 @@
+#include "alias_sampler.hpp"
+#include <cassert>
+#include <numeric>
+
+AliasSampler::AliasSampler(const std::vector<double> &weights) : m_Probs(weights.size()), m_Aliases(weights.size()) {
+    assert(!weights.empty());
+    double sum = std::accumulate(weights.cbegin(), weights.cend(), 0.0);
+    assert(sum > 0.0);
+    std::vector<unsigned int> small, large;
+    for (unsigned int i = 0; i < weights.size(); ++i) {
+        assert(weights[i] >= 0.0);
+        // Scaled so that the mean is one
+        m_Probs[i] = weights[i] * weights.size() / sum;
+        m_Aliases[i] = i;
+        (m_Probs[i] < 1.0 ? small : large).push_back(i);
+    }
+    // Each small column is filled up to one by a large column, which becomes its alias
+    while (!small.empty() && !large.empty()) {
+        auto smallIdx = small.back(), largeIdx = large.back();
+        small.pop_back();
+        m_Aliases[smallIdx] = largeIdx;
+        m_Probs[largeIdx] -= 1.0 - m_Probs[smallIdx];
+        if (m_Probs[largeIdx] < 1.0) {
+            large.pop_back();
+            small.push_back(largeIdx);
+        }
+    }
+    // The rest are one up to rounding errors
+    for (auto idx : small)
+        m_Probs[idx] = 1.0;
+    for (auto idx : large)
+        m_Probs[idx] = 1.0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// Samples indices in proportion to their weights in O(1) with Vose's alias method. The table is built once in O(n).
+class AliasSampler {
+private:
+    // The probability of keeping each column instead of taking its alias
+    std::vector<double> m_Probs;
+    std::vector<unsigned int> m_Aliases;
+
+public:
+    explicit AliasSampler(const std::vector<double> &weights);
+
+    unsigned int Size() const { return m_Probs.size(); }
+
+    template <typename TEngine>
+    unsigned int operator()(TEngine &engine) const {
+        // The integral part picks the column, and the fractional part decides whether to take the alias
+        std::uniform_real_distribution<double> random(0.0, m_Probs.size());
+        double value = random(engine);
+        auto column = std::min(static_cast<unsigned int>(value), Size() - 1);
+        return value - column < m_Probs[column] ? column : m_Aliases[column];
+    }
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// The index of the lowest set bit, which must exist.
+inline unsigned int CountTrailingZeros(std::uint64_t word) {
+    assert(word != 0);
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward64(&idx, word);
+    return idx;
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+inline unsigned int PopCount(std::uint64_t word) {
+#ifdef _MSC_VER
+    return static_cast<unsigned int>(__popcnt64(word));
+#else
+    return __builtin_popcountll(word);
+#endif
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cassert>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// A binary min-heap over items identified by dense indices [0, capacity), supporting O(log n) update of the key of
+// any item (both decrease and increase). Ties must be broken by the key itself to keep the order deterministic.
+template <typename TKey, typename TCompare = std::less<TKey>>
+class IndexedPriorityQueue {
+private:
+    static constexpr unsigned int NotInQueue = -1u;
+
+    TCompare m_Compare;
+    // Heap of item indices
+    std::vector<unsigned int> m_Heap;
+    // Item index -> position in the heap, NotInQueue if absent
+    std::vector<unsigned int> m_Positions;
+    // Item index -> key
+    std::vector<TKey> m_Keys;
+
+    bool Less(unsigned int pos1, unsigned int pos2) const {
+        return m_Compare(m_Keys[m_Heap[pos1]], m_Keys[m_Heap[pos2]]);
+    }
+
+    void Swap(unsigned int pos1, unsigned int pos2) {
+        std::swap(m_Heap[pos1], m_Heap[pos2]);
+        m_Positions[m_Heap[pos1]] = pos1;
+        m_Positions[m_Heap[pos2]] = pos2;
+    }
+
+    void SiftUp(unsigned int pos) {
+        while (pos > 0) {
+            auto parent = (pos - 1) / 2;
+            if (!Less(pos, parent))
+                break;
+            Swap(pos, parent);
+            pos = parent;
+        }
+    }
+
+    void SiftDown(unsigned int pos) {
+        while (true) {
+            auto smallest = pos, left = 2 * pos + 1, right = 2 * pos + 2;
+            if (left < m_Heap.size() && Less(left, smallest))
+                smallest = left;
+            if (right < m_Heap.size() && Less(right, smallest))
+                smallest = right;
+            if (smallest == pos)
+                break;
+            Swap(pos, smallest);
+            pos = smallest;
+        }
+    }
+
+public:
+    explicit IndexedPriorityQueue(unsigned int capacity = 0) { Reset(capacity); }
+
+    // Remove all items and resize the index space to [0, capacity).
+    void Reset(unsigned int capacity) {
+        m_Heap.clear();
+        m_Heap.reserve(capacity);
+        m_Positions.assign(capacity, NotInQueue);
+        m_Keys.resize(capacity);
+    }
+
+    unsigned int Size() const { return m_Heap.size(); }
+    bool Empty() const { return m_Heap.empty(); }
+    bool Contains(unsigned int idx) const { return idx < m_Positions.size() && m_Positions[idx] != NotInQueue; }
+
+    unsigned int Top() const {
+        assert(!Empty());
+        return m_Heap.front();
+    }
+    const TKey &TopKey() const { return GetKey(Top()); }
+    const TKey &GetKey(unsigned int idx) const {
+        assert(Contains(idx));
+        return m_Keys[idx];
+    }
+
+    void Push(unsigned int idx, const TKey &key) {
+        assert(idx < m_Positions.size());
+        assert(!Contains(idx));
+        m_Keys[idx] = key;
+        m_Positions[idx] = m_Heap.size();
+        m_Heap.push_back(idx);
+        SiftUp(m_Heap.size() - 1);
+    }
+
+    // Change the key of an item in the queue, or insert it if absent.
+    void Update(unsigned int idx, const TKey &key) {
+        if (!Contains(idx)) {
+            Push(idx, key);
+            return;
+        }
+        bool decrease = m_Compare(key, m_Keys[idx]);
+        m_Keys[idx] = key;
+        if (decrease)
+            SiftUp(m_Positions[idx]);
+        else
+            SiftDown(m_Positions[idx]);
+    }
+
+    void Remove(unsigned int idx) {
+        assert(Contains(idx));
+        auto pos = m_Positions[idx];
+        Swap(pos, m_Heap.size() - 1);
+        m_Heap.pop_back();
+        m_Positions[idx] = NotInQueue;
+        if (pos < m_Heap.size()) {
+            SiftUp(pos);
+            SiftDown(m_Positions[m_Heap[pos]]);
+        }
+    }
+
+    void Pop() { Remove(Top()); }
+};
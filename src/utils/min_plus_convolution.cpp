@@ -0,0 +1,118 @@
+#include "min_plus_convolution.hpp"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIN_PLUS_CONVOLUTION_SIMD
+using Vec = __m128d;
+using Mask = __m128d;
+static Vec Load(const double *ptr) { return _mm_loadu_pd(ptr); }
+static void Store(double *ptr, Vec x) { _mm_storeu_pd(ptr, x); }
+static Vec Broadcast(double value) { return _mm_set1_pd(value); }
+static Vec Add(Vec x, Vec y) { return _mm_add_pd(x, y); }
+static Mask Less(Vec x, Vec y) { return _mm_cmplt_pd(x, y); }
+static Vec Select(Mask mask, Vec x, Vec y) { return _mm_or_pd(_mm_and_pd(mask, x), _mm_andnot_pd(mask, y)); }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MIN_PLUS_CONVOLUTION_SIMD
+using Vec = float64x2_t;
+using Mask = uint64x2_t;
+static Vec Load(const double *ptr) { return vld1q_f64(ptr); }
+static void Store(double *ptr, Vec x) { vst1q_f64(ptr, x); }
+static Vec Broadcast(double value) { return vdupq_n_f64(value); }
+static Vec Add(Vec x, Vec y) { return vaddq_f64(x, y); }
+static Mask Less(Vec x, Vec y) { return vcltq_f64(x, y); }
+static Vec Select(Mask mask, Vec x, Vec y) { return vbslq_f64(mask, x, y); }
+#endif
+
+// The minimum of x[i] + y[i] for i < n and the smallest i reaching it, or 0 if none is below the maximum double
+static std::pair<double, unsigned int> ArgMinOfSumsScalar(const double *x, const double *y, unsigned int n) {
+    double minValue = std::numeric_limits<double>::max();
+    unsigned int minIdx = 0;
+    for (unsigned int i = 0; i < n; ++i)
+        if (x[i] + y[i] < minValue) {
+            minValue = x[i] + y[i];
+            minIdx = i;
+        }
+    return {minValue, minIdx};
+}
+
+#ifdef MIN_PLUS_CONVOLUTION_SIMD
+static std::pair<double, unsigned int> ArgMinOfSums(const double *x, const double *y, unsigned int n) {
+    // Two vectors of 2 lanes are unrolled, each lane keeping the minimum of every 4th sum with its first index, so that
+    // merging the lanes by value and then by index gives the same result as the scalar version. Indices are stored as
+    // doubles, which are exact.
+    constexpr unsigned int Width = 4;
+    if (n < Width)
+        return ArgMinOfSumsScalar(x, y, n);
+    static const double initialIndices[Width] = {0.0, 1.0, 2.0, 3.0};
+    Vec minValues[2] = {Broadcast(std::numeric_limits<double>::max()), Broadcast(std::numeric_limits<double>::max())};
+    Vec minIndices[2] = {Broadcast(0.0), Broadcast(0.0)};
+    Vec indices[2] = {Load(initialIndices), Load(initialIndices + 2)};
+    auto step = Broadcast(Width);
+    unsigned int i = 0;
+    for (; i + Width <= n; i += Width)
+        for (unsigned int k = 0; k < 2; ++k) {
+            auto sums = Add(Load(x + i + 2 * k), Load(y + i + 2 * k));
+            auto less = Less(sums, minValues[k]);
+            minValues[k] = Select(less, sums, minValues[k]);
+            minIndices[k] = Select(less, indices[k], minIndices[k]);
+            indices[k] = Add(indices[k], step);
+        }
+    double laneValues[Width], laneIndices[Width];
+    for (unsigned int k = 0; k < 2; ++k) {
+        Store(laneValues + 2 * k, minValues[k]);
+        Store(laneIndices + 2 * k, minIndices[k]);
+    }
+    double minValue = std::numeric_limits<double>::max();
+    unsigned int minIdx = 0;
+    for (unsigned int lane = 0; lane < Width; ++lane) {
+        auto laneIdx = static_cast<unsigned int>(laneIndices[lane]);
+        if (laneValues[lane] < minValue || (laneValues[lane] == minValue && laneIdx < minIdx)) {
+            minValue = laneValues[lane];
+            minIdx = laneIdx;
+        }
+    }
+    // The rest come after all lanes, so only a strictly smaller sum replaces the minimum
+    for (; i < n; ++i)
+        if (x[i] + y[i] < minValue) {
+            minValue = x[i] + y[i];
+            minIdx = i;
+        }
+    return {minValue, minIdx};
+}
+#else
+static std::pair<double, unsigned int> ArgMinOfSums(const double *x, const double *y, unsigned int n) {
+    return ArgMinOfSumsScalar(x, y, n);
+}
+#endif
+
+template <typename TArgMinOfSums>
+static void Convolve(const double *a, unsigned int aSize, const double *bReversed, unsigned int bSize, double *result,
+                     unsigned int *argMins, unsigned int resultSize, TArgMinOfSums argMinOfSums) {
+    assert(aSize > 0 && bSize > 0);
+    assert(resultSize <= aSize + bSize - 1);
+    for (unsigned int h = 0; h < resultSize; ++h) {
+        // i ranges over [iBegin, iEnd), and b[h - i] is bReversed[bSize - 1 - h + i]
+        auto iBegin = h < bSize ? 0 : h - (bSize - 1), iEnd = std::min(aSize, h + 1);
+        auto [minValue, minIdx] = argMinOfSums(a + iBegin, bReversed + (bSize - 1 - h + iBegin), iEnd - iBegin);
+        result[h] = minValue;
+        argMins[h] = minValue < std::numeric_limits<double>::max() ? iBegin + minIdx : 0;
+    }
+}
+
+void MinPlusConvolution(const double *a, unsigned int aSize, const double *bReversed, unsigned int bSize,
+                        double *result, unsigned int *argMins, unsigned int resultSize) {
+    Convolve(a, aSize, bReversed, bSize, result, argMins, resultSize, ArgMinOfSums);
+#if defined(MIN_PLUS_CONVOLUTION_SIMD) && !defined(NDEBUG)
+    std::vector<double> scalarResult(resultSize);
+    std::vector<unsigned int> scalarArgMins(resultSize);
+    Convolve(a, aSize, bReversed, bSize, scalarResult.data(), scalarArgMins.data(), resultSize, ArgMinOfSumsScalar);
+    assert(std::equal(result, result + resultSize, scalarResult.cbegin()));
+    assert(std::equal(argMins, argMins + resultSize, scalarArgMins.cbegin()));
+#endif
+}
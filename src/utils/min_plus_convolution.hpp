@@ -0,0 +1,8 @@
+#pragma once
+
+// The (min, +) convolution of a and b: for each h < resultSize, result[h] is the minimum of a[i] + b[h - i] over all
+// valid i, and argMins[h] is the smallest i reaching it, or 0 if none is below the maximum double. b is passed
+// reversed, i.e. bReversed[bSize - 1 - k] = b[k], so that both arrays are read forwards for each h. The result must not
+// overlap a or bReversed. Debug builds check the SIMD kernel against a scalar one, which gives identical results.
+void MinPlusConvolution(const double *a, unsigned int aSize, const double *bReversed, unsigned int bSize,
+                        double *result, unsigned int *argMins, unsigned int resultSize);
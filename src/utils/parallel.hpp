@@ -1,29 +1,75 @@
 #pragma once
 
+#include "thread_pool.hpp"
 #include <array>
-#include <future>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
 
+// Runs tasks on the shared ThreadPool, results are returned in the order of the tasks.
 class Parallel {
 public:
+    // Called after each task finishes with (task index, finished task count, total task count). The calls are
+    // serialized, so they may print without interleaving.
+    using ProgressCallback = std::function<void(unsigned int, unsigned int, unsigned int)>;
+
+    // Once cancelled, the tasks that have not started are skipped. Running tasks may poll IsCancelled to stop early.
+    class CancellationToken {
+    private:
+        std::atomic<bool> m_Cancelled = false;
+
+    public:
+        void Cancel() { m_Cancelled = true; }
+        bool IsCancelled() const { return m_Cancelled; }
+    };
+
     template <typename TRes, typename... TFuncs>
     static std::array<TRes, sizeof...(TFuncs)> Run(TFuncs &&...funcs) {
-        std::array futures = {std::async(std::launch::async, std::forward<TFuncs>(funcs))...};
+        std::array<std::function<TRes()>, sizeof...(TFuncs)> tasks = {std::function<TRes()>(
+            std::forward<TFuncs>(funcs))...};
         std::array<TRes, sizeof...(TFuncs)> results;
-        for (unsigned int i = 0; i < futures.size(); ++i)
-            results[i] = std::move(futures[i].get());
+        ThreadPool::GetInstance().RunAll(tasks.size(), [&](unsigned int idx) { results[idx] = tasks[idx](); });
         return results;
     }
 
     template <typename TRes, typename TFuncs>
-    static std::vector<TRes> RunRanks(const TFuncs &funcs, unsigned int count) {
-        std::vector<std::future<TRes>> futures;
-        futures.reserve(count);
-        for (unsigned int i = 0; i < count; ++i)
-            futures.push_back(std::async(std::launch::async, funcs, i));
-        std::vector<TRes> results;
-        results.reserve(count);
-        for (unsigned int i = 0; i < count; ++i)
-            results.push_back(std::move(futures[i].get()));
+    static std::vector<TRes> RunRanks(const TFuncs &funcs, unsigned int count,
+                                      const ProgressCallback &onProgress = nullptr) {
+        std::vector<std::optional<TRes>> results(count);
+        RunRanksInto(funcs, count, nullptr, onProgress, results);
+        std::vector<TRes> finalResults;
+        finalResults.reserve(count);
+        for (auto &result : results)
+            finalResults.push_back(std::move(*result));
+        return finalResults;
+    }
+
+    // The results of the skipped ranks are std::nullopt.
+    template <typename TRes, typename TFuncs>
+    static std::vector<std::optional<TRes>> RunRanks(const TFuncs &funcs, unsigned int count,
+                                                     const CancellationToken &token,
+                                                     const ProgressCallback &onProgress = nullptr) {
+        std::vector<std::optional<TRes>> results(count);
+        RunRanksInto(funcs, count, &token, onProgress, results);
         return results;
     }
+
+private:
+    template <typename TRes, typename TFuncs>
+    static void RunRanksInto(const TFuncs &funcs, unsigned int count, const CancellationToken *token,
+                             const ProgressCallback &onProgress, std::vector<std::optional<TRes>> &results) {
+        std::mutex progressMutex;
+        unsigned int finishedCount = 0;
+        ThreadPool::GetInstance().RunAll(count, [&](unsigned int rank) {
+            if (token && token->IsCancelled())
+                return;
+            results[rank].emplace(funcs(rank));
+            if (onProgress) {
+                std::lock_guard lock(progressMutex);
+                onProgress(rank, ++finishedCount, count);
+            }
+        });
+    }
 };
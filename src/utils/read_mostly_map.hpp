@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// A map filled once per key and then read from many threads. Lookups take no lock: the entries are published through
+// an open-addressing table of atomic pointers, which is replaced by a copy twice as large when half full. Entries and
+// old tables are only freed with the map, so a value stays valid and a reader never sees a freed table.
+template <typename TKey, typename TValue, typename THash>
+class ReadMostlyMap {
+private:
+    struct Entry {
+        const TKey Key;
+        const TValue Value;
+    };
+
+    struct Table {
+        const std::size_t Mask;
+        const std::unique_ptr<std::atomic<const Entry *>[]> Slots;
+
+        explicit Table(std::size_t capacity) : Mask(capacity - 1), Slots(new std::atomic<const Entry *>[capacity]) {
+            for (std::size_t i = 0; i < capacity; ++i)
+                Slots[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        // Only called by the writer holding the lock
+        void Insert(const Entry *entry) {
+            auto idx = THash()(entry->Key) & Mask;
+            while (Slots[idx].load(std::memory_order_relaxed))
+                idx = (idx + 1) & Mask;
+            Slots[idx].store(entry, std::memory_order_release);
+        }
+    };
+
+    std::atomic<const Table *> m_Table;
+    std::mutex m_WriteMtx;
+    std::vector<std::unique_ptr<const Entry>> m_Entries;
+    std::vector<std::unique_ptr<Table>> m_Tables;
+
+public:
+    ReadMostlyMap() {
+        m_Tables.push_back(std::make_unique<Table>(16));
+        m_Table.store(m_Tables.back().get(), std::memory_order_relaxed);
+    }
+    ReadMostlyMap(const ReadMostlyMap &) = delete;
+    ReadMostlyMap &operator=(const ReadMostlyMap &) = delete;
+
+    const TValue *Find(const TKey &key) const {
+        auto table = m_Table.load(std::memory_order_acquire);
+        for (auto idx = THash()(key) & table->Mask;; idx = (idx + 1) & table->Mask) {
+            auto entry = table->Slots[idx].load(std::memory_order_acquire);
+            if (!entry)
+                return nullptr;
+            if (entry->Key == key)
+                return &entry->Value;
+        }
+    }
+
+    // On a miss, create() is called under the lock and returns the key to store and the value. The stored key must
+    // equal the lookup key, but may own memory that the lookup key only views.
+    template <typename TCreate>
+    const TValue &GetOrCreate(const TKey &key, TCreate &&create) {
+        if (auto value = Find(key))
+            return *value;
+        std::scoped_lock lock(m_WriteMtx);
+        if (auto value = Find(key))
+            return *value;
+        auto [storedKey, value] = create();
+        m_Entries.emplace_back(new Entry{std::move(storedKey), std::move(value)});
+        auto table = m_Tables.back().get();
+        if (2 * m_Entries.size() > table->Mask + 1) {
+            m_Tables.push_back(std::make_unique<Table>(2 * (table->Mask + 1)));
+            table = m_Tables.back().get();
+            for (const auto &entry : m_Entries)
+                table->Insert(entry.get());
+            m_Table.store(table, std::memory_order_release);
+        } else
+            table->Insert(m_Entries.back().get());
+        return m_Entries.back()->Value;
+    }
+
+    // Not synchronized with GetOrCreate
+    std::size_t Size() const { return m_Entries.size(); }
+};
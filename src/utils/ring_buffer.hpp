@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// A lock-free ring buffer of fixed capacity, for exactly one producer thread and one consumer thread.
+template <typename T>
+class RingBuffer {
+private:
+    std::vector<T> m_Items;
+    // The number of items ever popped, only written by the consumer
+    alignas(64) std::atomic<std::size_t> m_Head = 0;
+    // The number of items ever pushed, only written by the producer
+    alignas(64) std::atomic<std::size_t> m_Tail = 0;
+
+public:
+    explicit RingBuffer(std::size_t capacity) : m_Items(capacity) { assert(capacity > 0); }
+
+    // Returns false if the buffer is full.
+    bool TryPush(const T &item) {
+        auto tail = m_Tail.load(std::memory_order_relaxed);
+        if (tail - m_Head.load(std::memory_order_acquire) >= m_Items.size())
+            return false;
+        m_Items[tail % m_Items.size()] = item;
+        m_Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Pop up to maxCount items into items, returns the number of popped items.
+    std::size_t TryPop(T *items, std::size_t maxCount) {
+        auto head = m_Head.load(std::memory_order_relaxed);
+        auto count = std::min(maxCount, m_Tail.load(std::memory_order_acquire) - head);
+        for (std::size_t i = 0; i < count; ++i)
+            items[i] = m_Items[(head + i) % m_Items.size()];
+        m_Head.store(head + count, std::memory_order_release);
+        return count;
+    }
+};
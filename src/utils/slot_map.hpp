@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cassert>
+#include <utility>
+#include <vector>
+
+// Items are stored contiguously for iteration, in no particular order, and removed in O(1) by moving the last item
+// into the hole. Each item is addressed by the index of its slot, which stays the same until the item is removed. A
+// freed slot is reused with a new generation, so a stale handle is detected.
+template <typename T>
+class SlotMap {
+public:
+    struct Handle {
+        unsigned int SlotIdx;
+        unsigned int Generation;
+    };
+
+private:
+    struct Slot {
+        // Position of the item in m_Items, only valid if the slot is in use
+        unsigned int ItemIdx;
+        unsigned int Generation = 0;
+        bool InUse = false;
+    };
+
+    std::vector<T> m_Items;
+    // Item position -> slot index
+    std::vector<unsigned int> m_ItemSlots;
+    std::vector<Slot> m_Slots;
+    std::vector<unsigned int> m_FreeSlots;
+
+public:
+    Handle Insert(T &&item) {
+        unsigned int slotIdx;
+        if (m_FreeSlots.empty()) {
+            slotIdx = m_Slots.size();
+            m_Slots.emplace_back();
+        } else {
+            slotIdx = m_FreeSlots.back();
+            m_FreeSlots.pop_back();
+        }
+        auto &slot = m_Slots[slotIdx];
+        slot.ItemIdx = m_Items.size();
+        slot.InUse = true;
+        m_Items.push_back(std::move(item));
+        m_ItemSlots.push_back(slotIdx);
+        return {slotIdx, slot.Generation};
+    }
+
+    void Remove(unsigned int slotIdx) {
+        assert(Contains(slotIdx));
+        auto &slot = m_Slots[slotIdx];
+        auto itemIdx = slot.ItemIdx;
+        if (itemIdx + 1 < m_Items.size()) {
+            m_Items[itemIdx] = std::move(m_Items.back());
+            m_ItemSlots[itemIdx] = m_ItemSlots.back();
+            m_Slots[m_ItemSlots[itemIdx]].ItemIdx = itemIdx;
+        }
+        m_Items.pop_back();
+        m_ItemSlots.pop_back();
+        slot.InUse = false;
+        ++slot.Generation;
+        m_FreeSlots.push_back(slotIdx);
+    }
+
+    bool Contains(unsigned int slotIdx) const { return slotIdx < m_Slots.size() && m_Slots[slotIdx].InUse; }
+    bool Contains(Handle handle) const {
+        return Contains(handle.SlotIdx) && m_Slots[handle.SlotIdx].Generation == handle.Generation;
+    }
+
+    T &operator[](unsigned int slotIdx) {
+        assert(Contains(slotIdx));
+        return m_Items[m_Slots[slotIdx].ItemIdx];
+    }
+    const T &operator[](unsigned int slotIdx) const {
+        assert(Contains(slotIdx));
+        return m_Items[m_Slots[slotIdx].ItemIdx];
+    }
+
+    // Returns the slot index of the item at the given position in GetItems.
+    unsigned int GetSlotIdx(unsigned int itemIdx) const { return m_ItemSlots[itemIdx]; }
+    // All slot indices are less than this
+    unsigned int GetSlotCount() const { return m_Slots.size(); }
+
+    const std::vector<T> &GetItems() const { return m_Items; }
+    unsigned int Size() const { return m_Items.size(); }
+    bool Empty() const { return m_Items.empty(); }
+    auto begin() const { return m_Items.cbegin(); }
+    auto end() const { return m_Items.cend(); }
+};
@@ -0,0 +1,131 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cassert>
+
+// Set on the worker threads, used to help with nested batches instead of blocking a worker
+static thread_local const ThreadPool *CurrentPool = nullptr;
+static thread_local unsigned int CurrentWorkerIdx = 0;
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    assert(threadCount > 0);
+    for (unsigned int i = 0; i < threadCount; ++i)
+        m_Workers.push_back(std::make_unique<Worker>());
+    m_Threads.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i)
+        m_Threads.emplace_back(&ThreadPool::WorkerMain, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(m_SleepMutex);
+        m_Stopping = true;
+    }
+    m_HasTasks.notify_all();
+    for (auto &thread : m_Threads)
+        thread.join();
+}
+
+bool ThreadPool::TryPopTask(unsigned int workerIdx, Task &task) {
+    for (unsigned int i = 0; i < m_Workers.size(); ++i) {
+        auto &worker = *m_Workers[(workerIdx + i) % m_Workers.size()];
+        std::lock_guard lock(worker.Mutex);
+        if (worker.Tasks.empty())
+            continue;
+        if (i == 0) {
+            task = worker.Tasks.back();
+            worker.Tasks.pop_back();
+        } else {
+            task = worker.Tasks.front();
+            worker.Tasks.pop_front();
+        }
+        --m_PendingCount;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::RunTask(const Task &task) {
+    auto &batch = *task.Owner;
+    std::exception_ptr exception;
+    try {
+        (*batch.Func)(task.Idx);
+    } catch (...) {
+        exception = std::current_exception();
+    }
+    // Decremented under the lock, so the batch is not destroyed before the notification
+    std::lock_guard lock(batch.Mutex);
+    if (exception && !batch.Exception)
+        batch.Exception = std::move(exception);
+    if (--batch.RemainingCount == 0) {
+        batch.Finished.notify_all();
+        if (batch.Helped) {
+            {
+                std::lock_guard sleepLock(m_SleepMutex);
+            }
+            m_HasTasks.notify_all();
+        }
+    }
+}
+
+void ThreadPool::WorkerMain(unsigned int workerIdx) {
+    CurrentPool = this;
+    CurrentWorkerIdx = workerIdx;
+    while (true) {
+        Task task;
+        if (TryPopTask(workerIdx, task)) {
+            RunTask(task);
+            continue;
+        }
+        std::unique_lock lock(m_SleepMutex);
+        m_HasTasks.wait(lock, [this] { return m_Stopping || m_PendingCount > 0; });
+        if (m_Stopping && m_PendingCount == 0)
+            return;
+    }
+}
+
+void ThreadPool::RunAll(unsigned int count, const std::function<void(unsigned int)> &func) {
+    if (count == 0)
+        return;
+    Batch batch;
+    batch.Func = &func;
+    batch.Helped = CurrentPool == this;
+    batch.RemainingCount = count;
+    // Counted before pushing so it never underflows, workers seeing the count early only retry
+    m_PendingCount += count;
+    // Contiguous ranges of tasks go to each worker, imbalances are evened out by stealing
+    for (unsigned int workerIdx = 0; workerIdx < m_Workers.size(); ++workerIdx) {
+        auto begin = static_cast<unsigned long long>(count) * workerIdx / m_Workers.size();
+        auto end = static_cast<unsigned long long>(count) * (workerIdx + 1) / m_Workers.size();
+        auto &worker = *m_Workers[workerIdx];
+        std::lock_guard lock(worker.Mutex);
+        // Pushed in reverse, so the owner pops the tasks in order
+        for (auto idx = end; idx > begin; --idx)
+            worker.Tasks.push_back({&batch, static_cast<unsigned int>(idx - 1)});
+    }
+    {
+        std::lock_guard lock(m_SleepMutex);
+    }
+    m_HasTasks.notify_all();
+
+    if (batch.Helped) {
+        while (batch.RemainingCount > 0) {
+            Task task;
+            if (TryPopTask(CurrentWorkerIdx, task)) {
+                RunTask(task);
+                continue;
+            }
+            // Sleep until there are tasks to help with, or the rest of the batch has finished on other workers
+            std::unique_lock lock(m_SleepMutex);
+            m_HasTasks.wait(lock, [this, &batch] { return batch.RemainingCount == 0 || m_PendingCount > 0; });
+        }
+    }
+    std::unique_lock lock(batch.Mutex);
+    batch.Finished.wait(lock, [&batch] { return batch.RemainingCount == 0; });
+    if (batch.Exception)
+        std::rethrow_exception(batch.Exception);
+}
+
+ThreadPool &ThreadPool::GetInstance() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+}
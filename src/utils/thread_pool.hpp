@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads, each with its own task deque. A worker runs its own tasks from the back of its deque
+// and steals from the front of the others' deques when it runs out. Worker threads are reused across tasks, so tasks
+// must not rely on fresh thread_local state.
+class ThreadPool {
+private:
+    // A batch of tasks submitted by one call to RunAll
+    struct Batch {
+        const std::function<void(unsigned int)> *Func;
+        // Whether the submitter is a worker, which waits on m_HasTasks to keep helping
+        bool Helped;
+        std::atomic<unsigned int> RemainingCount;
+        std::mutex Mutex;
+        std::condition_variable Finished;
+        // The first exception thrown by a task, rethrown by RunAll
+        std::exception_ptr Exception;
+    };
+    struct Task {
+        Batch *Owner;
+        unsigned int Idx;
+    };
+    struct alignas(64) Worker {
+        std::mutex Mutex;
+        std::deque<Task> Tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_Workers;
+    std::vector<std::thread> m_Threads;
+    // The number of tasks in all deques, workers sleep when there are none
+    std::atomic<unsigned int> m_PendingCount = 0;
+    std::mutex m_SleepMutex;
+    std::condition_variable m_HasTasks;
+    bool m_Stopping = false;
+
+    // Pop from the back of the deque of the worker, or steal from the front of another deque.
+    bool TryPopTask(unsigned int workerIdx, Task &task);
+    void RunTask(const Task &task);
+    void WorkerMain(unsigned int workerIdx);
+
+public:
+    explicit ThreadPool(unsigned int threadCount);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned int GetThreadCount() const { return m_Threads.size(); }
+
+    // Run func(0), ..., func(count - 1) on the workers and wait for all of them. A worker calling this runs the tasks
+    // itself while waiting, so tasks may submit nested batches. If tasks throw, the first exception is rethrown once
+    // all tasks have finished.
+    void RunAll(unsigned int count, const std::function<void(unsigned int)> &func);
+
+    // The pool shared by all experiments, with one worker per hardware thread
+    static ThreadPool &GetInstance();
+};
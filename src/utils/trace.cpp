@@ -1,95 +1,175 @@
 #include "trace.hpp"
 #include "job.hpp"
-#include <fstream>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
 #include <nlohmann/json.hpp>
+#include <vector>
 
-std::string Tracer::GetEventNameFromJob(const Job &job, bool includeStep, bool includeGroup, bool includeCommOp,
-                                        bool includeTransmission, bool includeWaiting) const {
-    std::string name = "Job #" + std::to_string(job.ID);
-    if (includeStep)
-        name += " Step #" + std::to_string(job.GetCurrentStepIdx());
-    if (includeGroup)
-        name += " Group #" + std::to_string(job.GetCurrentGroupIdx());
-    if (includeCommOp)
-        name += " CommOp #" + std::to_string(job.GetCurrentOpIdx());
-    if (includeTransmission)
-        name += (job.IsUsingSharp() ? " Transmission(SHARP, " : " Transmission(Non-SHARP, ") +
-                std::to_string(job.GetCurrentOpTransmittedMessageSize()) + "B~" +
-                std::to_string(job.GetCurrentOpTransmittedMessageSize() + job.GetTransmittingMessageSize()) + "B)";
-    if (includeWaiting)
-        name += " Waiting";
-    return name;
-}
-
-Tracer::~Tracer() {
-    if (!EnableRecording)
-        return;
-    std::ofstream file("results/trace.json");
-    file << m_RecordedTraces;
-}
-
-void Tracer::RecordEvent(std::string &&name, std::string_view category, bool isBegin, unsigned int pid,
-                         unsigned int tid, double time) {
-    if (!EnableRecording)
-        return;
-    m_RecordedTraces.push_back({
-        {"name", name},
-        {"cat", category},
-        {"ph", isBegin ? "B" : "E"},
-        {"pid", pid},
-        {"tid", tid},
-        {"ts", time * 1'000'000},
-    });
-}
-
-void Tracer::RecordBeginJob(double time, const Job &job) {
-    RecordEvent(GetEventNameFromJob(job), "Job", true, 0, job.ID, time);
+unsigned int Tracer::GetCategoryBit(Category category, bool isUsingSharp) {
+    if (category == Category::Transmission && !isUsingSharp)
+        return 1u << (static_cast<unsigned int>(Category::Waiting) + 1);
+    return 1u << static_cast<unsigned int>(category);
 }
 
-void Tracer::RecordEndJob(double time, const Job &job) {
-    RecordEvent(GetEventNameFromJob(job), "Job", false, 0, job.ID, time);
+std::string Tracer::GetEventName(const Event &event) {
+    std::string name = "Job #" + std::to_string(event.JobID);
+    if (event.EventCategory == Category::Job)
+        return name;
+    name += " Step #" + std::to_string(event.StepIdx);
+    if (event.EventCategory == Category::Step)
+        return name;
+    name += " Group #" + std::to_string(event.GroupIdx);
+    if (event.EventCategory == Category::Group)
+        return name;
+    name += " CommOp #" + std::to_string(event.OpIdx);
+    if (event.EventCategory == Category::Transmission)
+        name += (event.IsUsingSharp ? " Transmission(SHARP, " : " Transmission(Non-SHARP, ") +
+                std::to_string(event.TransmittedMessageSize) + "B~" +
+                std::to_string(event.TransmittedMessageSize + event.TransmittingMessageSize) + "B)";
+    else if (event.EventCategory == Category::Waiting)
+        name += " Waiting";
+    return name;
 }
 
-void Tracer::RecordBeginStep(double time, const Job &job) {
-    RecordEvent(GetEventNameFromJob(job, true), "Step", true, 0, job.ID, time);
+std::string_view Tracer::GetCategoryName(Category category, bool isUsingSharp) {
+    switch (category) {
+    case Category::Job:
+        return "Job";
+    case Category::Step:
+        return "Step";
+    case Category::Group:
+        return "Group";
+    case Category::CommOp:
+        return "CommOp";
+    case Category::Transmission:
+        return isUsingSharp ? "Transmission,SHARP" : "Transmission,NonSHARP";
+    case Category::Waiting:
+        return "Waiting";
+    }
+    return "";
 }
 
-void Tracer::RecordEndStep(double time, const Job &job) {
-    RecordEvent(GetEventNameFromJob(job, true), "Step", false, 0, job.ID, time);
+Tracer::Tracer(const std::string &fileName, const Filter &filter)
+    : m_Filter(filter), m_File(fileName, std::ios::binary), m_Buffer(BufferCapacity) {
+    assert(m_Filter.StepSamplingInterval > 0);
+    for (auto category : {Category::Job, Category::Step, Category::Group, Category::CommOp, Category::Transmission,
+                          Category::Waiting})
+        for (auto isUsingSharp : {false, true}) {
+            auto name = std::string(GetCategoryName(category, isUsingSharp));
+            if (m_Filter.Categories.empty() || m_Filter.Categories.count(name) > 0)
+                m_CategoryMask |= GetCategoryBit(category, isUsingSharp);
+        }
+    std::uint32_t recordSize = sizeof(Event);
+    m_File.write(FileMagic, sizeof(FileMagic));
+    m_File.write(reinterpret_cast<const char *>(&recordSize), sizeof(recordSize));
+    m_Writer = std::thread(&Tracer::WriteEvents, this);
 }
 
-void Tracer::RecordBeginGroup(double time, const Job &job) {
-    RecordEvent(GetEventNameFromJob(job, true, true), "Group", true, 0, job.ID, time);
-}
+Tracer::~Tracer() { Close(); }
 
-void Tracer::RecordEndGroup(double time, const Job &job) {
-    RecordEvent(GetEventNameFromJob(job, true, true), "Group", false, 0, job.ID, time);
-}
-
-void Tracer::RecordBeginCommOp(double time, const Job &job) {
-    RecordEvent(GetEventNameFromJob(job, true, true, true), "CommOp", true, 0, job.ID, time);
+void Tracer::Close() {
+    if (m_IsClosed.exchange(true))
+        return;
+    m_Writer.join();
+    m_File.close();
 }
 
-void Tracer::RecordEndCommOp(double time, const Job &job) {
-    RecordEvent(GetEventNameFromJob(job, true, true, true), "CommOp", false, 0, job.ID, time);
+void Tracer::WriteEvents() {
+    std::vector<Event> events(WriteBatchSize);
+    while (true) {
+        // Check before popping, so that no event is left once closed
+        auto isClosed = m_IsClosed.load();
+        auto count = m_Buffer.TryPop(events.data(), events.size());
+        if (count > 0)
+            m_File.write(reinterpret_cast<const char *>(events.data()), count * sizeof(Event));
+        else if (isClosed)
+            break;
+        else
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
 }
 
-void Tracer::RecordBeginTransmission(double time, const Job &job) {
-    auto category = job.IsUsingSharp() ? "Transmission,SHARP" : "Transmission,NonSHARP";
-    RecordEvent(GetEventNameFromJob(job, true, true, true, true), category, true, 0, job.ID, time);
+void Tracer::RecordEvent(Category category, bool isBegin, double time, const Job &job) {
+    assert(!m_IsClosed);
+    if (isBegin) {
+        if (time < m_Filter.BeginTime || time > m_Filter.EndTime)
+            return;
+        if ((m_CategoryMask & GetCategoryBit(category, job.IsUsingSharp())) == 0)
+            return;
+        if (category != Category::Job && job.GetCurrentStepIdx() % m_Filter.StepSamplingInterval != 0)
+            return;
+    } else {
+        // The events of a job are nested, so the begin event is the innermost open one if it has been recorded
+        auto iter = m_OpenEvents.find(job.ID);
+        if (iter == m_OpenEvents.end() || iter->second.back().EventCategory != category)
+            return;
+        iter->second.pop_back();
+        if (iter->second.empty())
+            m_OpenEvents.erase(iter);
+        time = std::min(time, m_Filter.EndTime);
+    }
+    Event event{
+        time,
+        category,
+        isBegin,
+        job.IsUsingSharp(),
+        job.ID,
+        job.GetCurrentStepIdx(),
+        job.GetCurrentGroupIdx(),
+        job.GetCurrentOpIdx(),
+        job.GetCurrentOpTransmittedMessageSize(),
+        job.GetTransmittingMessageSize(),
+    };
+    if (isBegin)
+        m_OpenEvents[job.ID].push_back(event);
+    PushEvent(event);
 }
 
-void Tracer::RecordEndTransmission(double time, const Job &job) {
-    auto category = job.IsUsingSharp() ? "Transmission,SHARP" : "Transmission,NonSHARP";
-    RecordEvent(GetEventNameFromJob(job, true, true, true, true), category, false, 0, job.ID, time);
+void Tracer::EndOpenEvents(double time, const Job &job) {
+    auto iter = m_OpenEvents.find(job.ID);
+    if (iter == m_OpenEvents.end())
+        return;
+    for (auto event = iter->second.rbegin(); event != iter->second.rend(); ++event) {
+        event->Time = std::min(time, m_Filter.EndTime);
+        event->IsBegin = false;
+        PushEvent(*event);
+    }
+    m_OpenEvents.erase(iter);
 }
 
-void Tracer::RecordBeginWaiting(double time, const Job &job) {
-    RecordEvent(GetEventNameFromJob(job, true, true, true, false, true), "Waiting", true, 0, job.ID, time);
+void Tracer::PushEvent(const Event &event) {
+    // Wait for the writer if the buffer is full
+    while (!m_Buffer.TryPush(event))
+        std::this_thread::yield();
 }
 
-void Tracer::RecordEndWaiting(double time, const Job &job) {
-    RecordEvent(GetEventNameFromJob(job, true, true, true, false, true), "Waiting", false, 0, job.ID, time);
+bool Tracer::ConvertToChromeTrace(const std::string &binaryFileName, const std::string &jsonFileName) {
+    std::ifstream binaryFile(binaryFileName, std::ios::binary);
+    char magic[sizeof(FileMagic)];
+    std::uint32_t recordSize;
+    binaryFile.read(magic, sizeof(magic));
+    binaryFile.read(reinterpret_cast<char *>(&recordSize), sizeof(recordSize));
+    if (!binaryFile || !std::equal(magic, magic + sizeof(magic), FileMagic) || recordSize != sizeof(Event))
+        return false;
+    std::ofstream jsonFile(jsonFileName);
+    jsonFile << '[';
+    Event event;
+    bool isFirst = true;
+    while (binaryFile.read(reinterpret_cast<char *>(&event), sizeof(event))) {
+        if (!isFirst)
+            jsonFile << ',';
+        isFirst = false;
+        jsonFile << nlohmann::json{
+            {"name", GetEventName(event)},
+            {"cat", GetCategoryName(event.EventCategory, event.IsUsingSharp)},
+            {"ph", event.IsBegin ? "B" : "E"},
+            {"pid", 0},
+            {"tid", event.JobID},
+            {"ts", event.Time * 1'000'000},
+        };
+    }
+    jsonFile << ']';
+    return true;
 }
-
-Tracer Trace;
@@ -1,38 +1,111 @@
 #pragma once
 
-#include <nlohmann/json.hpp>
+#include "utils/ring_buffer.hpp"
+#include <atomic>
+#include <fstream>
+#include <limits>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 class Job;
 
+// Records the events of the jobs in a simulation, see AllocationController::RecordTraces. Jobs without a tracer
+// record nothing, so tracing costs nothing when disabled. The events are fixed-size records streamed through a ring
+// buffer to a binary file by a background thread, so the memory stays bounded however long the simulation runs.
+// Their names are only formatted when converted, see ConvertToChromeTrace.
 class Tracer {
+public:
+    // Filtered events are dropped before anything is recorded. Only begin events are filtered, an end event is recorded
+    // if and only if its begin event is, and no later than EndTime, so that the events stay balanced.
+    struct Filter {
+        // Only trace these jobs, all jobs if empty
+        std::unordered_set<unsigned int> JobIDs;
+        // Also trace the jobs in the same sharing groups as the jobs above
+        bool IncludeSharingGroups = false;
+        // Only trace these categories, all categories if empty. The categories are Job, Step, Group, CommOp,
+        // Transmission,SHARP, Transmission,NonSHARP, and Waiting.
+        std::unordered_set<std::string> Categories;
+        // Only trace the events in [BeginTime, EndTime], in second
+        double BeginTime = 0.0;
+        double EndTime = std::numeric_limits<double>::infinity();
+        // Only trace one in every StepSamplingInterval steps of each job, except for the events of the job itself
+        unsigned int StepSamplingInterval = 1;
+    };
+
 private:
-    nlohmann::json m_RecordedTraces;
+    enum class Category {
+        Job,
+        Step,
+        Group,
+        CommOp,
+        Transmission,
+        Waiting,
+    };
 
-    std::string GetEventNameFromJob(const Job &job, bool includeStep = false, bool includeGroup = false,
-                                    bool includeCommOp = false, bool includeTransmission = false,
-                                    bool includeWaiting = false) const;
+    struct Event {
+        double Time;
+        Category EventCategory;
+        bool IsBegin;
+        bool IsUsingSharp;
+        unsigned int JobID;
+        unsigned int StepIdx;
+        unsigned int GroupIdx;
+        unsigned int OpIdx;
+        unsigned long long TransmittedMessageSize;
+        unsigned long long TransmittingMessageSize;
+    };
 
-public:
-    bool EnableRecording = false;
+    // The binary file starts with the magic and the size of a record, followed by the raw records
+    static constexpr char FileMagic[8] = {'M', 'I', 'N', 'A', 'T', 'R', 'C', '1'};
+    static constexpr std::size_t BufferCapacity = 1 << 16;
+    static constexpr std::size_t WriteBatchSize = 1 << 12;
+
+    const Filter m_Filter;
+    // The bits of the traced categories, see GetCategoryBit
+    unsigned int m_CategoryMask = 0;
+
+    std::ofstream m_File;
+    RingBuffer<Event> m_Buffer;
+    std::atomic<bool> m_IsClosed = false;
+    std::thread m_Writer;
+    // Job ID -> the recorded begin events not ended yet, outermost first
+    std::unordered_map<unsigned int, std::vector<Event>> m_OpenEvents;
+
+    static unsigned int GetCategoryBit(Category category, bool isUsingSharp);
+    static std::string GetEventName(const Event &event);
+    static std::string_view GetCategoryName(Category category, bool isUsingSharp);
 
+    void RecordEvent(Category category, bool isBegin, double time, const Job &job);
+    void PushEvent(const Event &event);
+    void WriteEvents();
+
+public:
+    explicit Tracer(const std::string &fileName, const Filter &filter);
     ~Tracer();
 
-    void RecordEvent(std::string &&name, std::string_view category, bool isBegin, unsigned int pid, unsigned int tid,
-                     double time);
-
-    void RecordBeginJob(double time, const Job &job);
-    void RecordEndJob(double time, const Job &job);
-    void RecordBeginStep(double time, const Job &job);
-    void RecordEndStep(double time, const Job &job);
-    void RecordBeginGroup(double time, const Job &job);
-    void RecordEndGroup(double time, const Job &job);
-    void RecordBeginCommOp(double time, const Job &job);
-    void RecordEndCommOp(double time, const Job &job);
-    void RecordBeginTransmission(double time, const Job &job);
-    void RecordEndTransmission(double time, const Job &job);
-    void RecordBeginWaiting(double time, const Job &job);
-    void RecordEndWaiting(double time, const Job &job);
-};
+    // Write the remaining events and close the file. No more events can be recorded.
+    void Close();
+    // Record the ends of the events of the job still open, before it stops being traced or the simulation stops.
+    void EndOpenEvents(double time, const Job &job);
 
-extern Tracer Trace;
+    // Convert the binary file to the Trace Event Format of Chrome, which Perfetto also opens. The events are
+    // converted one by one, so the memory stays bounded. Returns false if the binary file is invalid.
+    static bool ConvertToChromeTrace(const std::string &binaryFileName, const std::string &jsonFileName);
+
+    void RecordBeginJob(double time, const Job &job) { RecordEvent(Category::Job, true, time, job); }
+    void RecordEndJob(double time, const Job &job) { RecordEvent(Category::Job, false, time, job); }
+    void RecordBeginStep(double time, const Job &job) { RecordEvent(Category::Step, true, time, job); }
+    void RecordEndStep(double time, const Job &job) { RecordEvent(Category::Step, false, time, job); }
+    void RecordBeginGroup(double time, const Job &job) { RecordEvent(Category::Group, true, time, job); }
+    void RecordEndGroup(double time, const Job &job) { RecordEvent(Category::Group, false, time, job); }
+    void RecordBeginCommOp(double time, const Job &job) { RecordEvent(Category::CommOp, true, time, job); }
+    void RecordEndCommOp(double time, const Job &job) { RecordEvent(Category::CommOp, false, time, job); }
+    void RecordBeginTransmission(double time, const Job &job) { RecordEvent(Category::Transmission, true, time, job); }
+    void RecordEndTransmission(double time, const Job &job) { RecordEvent(Category::Transmission, false, time, job); }
+    void RecordBeginWaiting(double time, const Job &job) { RecordEvent(Category::Waiting, true, time, job); }
+    void RecordEndWaiting(double time, const Job &job) { RecordEvent(Category::Waiting, false, time, job); }
+};
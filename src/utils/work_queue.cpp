@@ -0,0 +1,179 @@
+#include "work_queue.hpp"
+#include <cassert>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <unistd.h>
+
+static std::string CreateWorkerID() {
+    char hostName[256] = {};
+    gethostname(hostName, sizeof(hostName) - 1);
+    return std::string(hostName) + '-' + std::to_string(getpid());
+}
+
+DirectoryWorkQueue::DirectoryWorkQueue(const std::filesystem::path &dir, unsigned int taskCount,
+                                       std::chrono::seconds leaseTimeout)
+    : m_Dir(dir), m_TaskCount(taskCount), m_LeaseTimeout(leaseTimeout), m_WorkerID(CreateWorkerID()),
+      m_FinishedTasks(taskCount), m_AbandonedTasks(taskCount), m_LeaseExpiryTimes(taskCount) {
+    assert(leaseTimeout.count() > 0);
+    std::filesystem::create_directories(m_Dir / "locks");
+    std::filesystem::create_directories(m_Dir / "results");
+    // Workers start at different tasks to avoid contending for the same locks
+    if (m_TaskCount > 0)
+        m_Cursor = std::hash<std::string>()(m_WorkerID) % m_TaskCount;
+    m_Heartbeat = std::thread(&DirectoryWorkQueue::RenewLeases, this);
+}
+
+DirectoryWorkQueue::~DirectoryWorkQueue() {
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_StopCondition.notify_all();
+    m_Heartbeat.join();
+}
+
+std::filesystem::path DirectoryWorkQueue::GetLockPath(unsigned int taskIdx) const {
+    return m_Dir / "locks" / (std::to_string(taskIdx) + ".lock");
+}
+
+std::filesystem::path DirectoryWorkQueue::GetResultPath(unsigned int taskIdx) const {
+    return m_Dir / "results" / (std::to_string(taskIdx) + ".json");
+}
+
+static std::string ReadOwner(const std::filesystem::path &lockPath) {
+    std::ifstream lockFile(lockPath);
+    std::string owner;
+    std::getline(lockFile, owner);
+    return owner;
+}
+
+bool DirectoryWorkQueue::TryClaim(unsigned int taskIdx) {
+    auto resultPath = GetResultPath(taskIdx);
+    if (std::filesystem::exists(resultPath)) {
+        m_FinishedTasks[taskIdx] = true;
+        return false;
+    }
+    auto lockPath = GetLockPath(taskIdx);
+    auto tempPath = lockPath;
+    tempPath += '.' + m_WorkerID + ".tmp";
+    std::ofstream(tempPath) << m_WorkerID << '\n';
+    // Hard links are atomic and fail if the target exists, also on network filesystems
+    std::error_code ec;
+    std::filesystem::create_hard_link(tempPath, lockPath, ec);
+    if (ec) {
+        std::error_code timeEc;
+        auto owner = ReadOwner(lockPath);
+        auto lastWriteTime = std::filesystem::last_write_time(lockPath, timeEc);
+        auto age = std::filesystem::file_time_type::clock::now() - lastWriteTime;
+        if (!timeEc && age <= m_LeaseTimeout) {
+            auto remainingTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(m_LeaseTimeout - age);
+            m_LeaseExpiryTimes[taskIdx] = std::chrono::steady_clock::now() + remainingTime;
+        } else if (!timeEc) {
+            // Other workers may be taking over the same lock, and one of them may already have replaced it with its own
+            // lock. The lock moved away is checked to be the expired one, otherwise it is moved back.
+            auto expiredPath = lockPath;
+            expiredPath += '.' + m_WorkerID + ".expired";
+            std::error_code renameEc;
+            std::filesystem::rename(lockPath, expiredPath, renameEc);
+            if (!renameEc) {
+                auto movedLastWriteTime = std::filesystem::last_write_time(expiredPath, timeEc);
+                if (!timeEc && movedLastWriteTime == lastWriteTime && ReadOwner(expiredPath) == owner) {
+                    std::filesystem::create_hard_link(tempPath, lockPath, ec);
+                } else {
+                    // Fails if yet another worker has claimed the task meanwhile, which then runs it twice at worst
+                    std::filesystem::create_hard_link(expiredPath, lockPath, renameEc);
+                }
+                std::filesystem::remove(expiredPath, renameEc);
+            }
+        }
+    }
+    std::error_code removeEc;
+    std::filesystem::remove(tempPath, removeEc);
+    if (ec)
+        return false;
+    // The task may have finished between the check and the claim
+    if (std::filesystem::exists(resultPath)) {
+        m_FinishedTasks[taskIdx] = true;
+        std::filesystem::remove(lockPath, removeEc);
+        return false;
+    }
+    return true;
+}
+
+void DirectoryWorkQueue::RenewLeases() {
+    std::unique_lock lock(m_Mutex);
+    auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(m_LeaseTimeout) / 4;
+    while (!m_StopCondition.wait_for(lock, interval, [this] { return m_Stopping; })) {
+        auto now = std::filesystem::file_time_type::clock::now();
+        for (auto taskIdx : m_ClaimedTasks) {
+            std::error_code ec;
+            std::filesystem::last_write_time(GetLockPath(taskIdx), now, ec);
+        }
+    }
+}
+
+std::optional<unsigned int> DirectoryWorkQueue::Claim() {
+    std::lock_guard lock(m_Mutex);
+    auto now = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < m_TaskCount; ++i) {
+        auto taskIdx = m_Cursor;
+        m_Cursor = (m_Cursor + 1) % m_TaskCount;
+        if (m_FinishedTasks[taskIdx] || m_AbandonedTasks[taskIdx] || m_ClaimedTasks.count(taskIdx) > 0 ||
+            now < m_LeaseExpiryTimes[taskIdx])
+            continue;
+        if (TryClaim(taskIdx)) {
+            m_ClaimedTasks.insert(taskIdx);
+            return taskIdx;
+        }
+    }
+    return std::nullopt;
+}
+
+void DirectoryWorkQueue::Finish(unsigned int taskIdx, const std::string &result) {
+    auto resultPath = GetResultPath(taskIdx);
+    auto tempPath = resultPath;
+    tempPath += '.' + m_WorkerID + ".tmp";
+    std::ofstream(tempPath) << result;
+    std::filesystem::rename(tempPath, resultPath);
+    std::lock_guard lock(m_Mutex);
+    assert(m_ClaimedTasks.count(taskIdx) > 0);
+    m_ClaimedTasks.erase(taskIdx);
+    m_FinishedTasks[taskIdx] = true;
+    // The lock may have been taken over if this worker was taken for dead
+    auto lockPath = GetLockPath(taskIdx);
+    if (ReadOwner(lockPath) == m_WorkerID) {
+        std::error_code ec;
+        std::filesystem::remove(lockPath, ec);
+    }
+}
+
+void DirectoryWorkQueue::Abandon(unsigned int taskIdx) {
+    std::lock_guard lock(m_Mutex);
+    assert(m_ClaimedTasks.count(taskIdx) > 0);
+    m_ClaimedTasks.erase(taskIdx);
+    m_AbandonedTasks[taskIdx] = true;
+    auto lockPath = GetLockPath(taskIdx);
+    if (ReadOwner(lockPath) == m_WorkerID) {
+        std::error_code ec;
+        std::filesystem::remove(lockPath, ec);
+    }
+}
+
+bool DirectoryWorkQueue::IsAbandoned(unsigned int taskIdx) {
+    std::lock_guard lock(m_Mutex);
+    return m_AbandonedTasks[taskIdx];
+}
+
+bool DirectoryWorkQueue::IsFinished(unsigned int taskIdx) const {
+    return std::filesystem::exists(GetResultPath(taskIdx));
+}
+
+std::optional<std::string> DirectoryWorkQueue::GetResult(const std::filesystem::path &dir, unsigned int taskIdx) {
+    std::ifstream file(dir / "results" / (std::to_string(taskIdx) + ".json"));
+    if (!file)
+        return std::nullopt;
+    std::stringstream result;
+    result << file.rdbuf();
+    return result.str();
+}
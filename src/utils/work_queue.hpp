@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// A queue of tasks [0, taskCount) shared by processes through a directory, e.g. on a shared filesystem, without any
+// network service. A task is claimed by hard-linking a lock file into place, which fails if the lock exists, and its
+// result is published by an atomic rename. Claimed tasks are leased: the lock files are touched periodically, and a
+// lock not touched for the lease timeout is taken over by another worker. A task may be run twice if a worker is taken
+// for dead while it is still running, so the results of a task must not depend on who runs it.
+class DirectoryWorkQueue {
+private:
+    // Contains locks/<task index>.lock and results/<task index>.json
+    const std::filesystem::path m_Dir;
+    const unsigned int m_TaskCount;
+    const std::chrono::seconds m_LeaseTimeout;
+    // Unique among all workers, used to name temporary files
+    const std::string m_WorkerID;
+
+    std::mutex m_Mutex;
+    // The next task to try to claim
+    unsigned int m_Cursor = 0;
+    std::unordered_set<unsigned int> m_ClaimedTasks;
+    // Tasks seen finished are never checked again
+    std::vector<bool> m_FinishedTasks;
+    // Tasks this worker failed to run, which it does not claim again
+    std::vector<bool> m_AbandonedTasks;
+    // A task leased by another worker is not checked again before its lease may have expired
+    std::vector<std::chrono::steady_clock::time_point> m_LeaseExpiryTimes;
+    bool m_Stopping = false;
+    std::condition_variable m_StopCondition;
+    // Renews the leases of the claimed tasks
+    std::thread m_Heartbeat;
+
+    std::filesystem::path GetLockPath(unsigned int taskIdx) const;
+    std::filesystem::path GetResultPath(unsigned int taskIdx) const;
+    bool TryClaim(unsigned int taskIdx);
+    void RenewLeases();
+
+public:
+    explicit DirectoryWorkQueue(const std::filesystem::path &dir, unsigned int taskCount,
+                                std::chrono::seconds leaseTimeout);
+    ~DirectoryWorkQueue();
+    DirectoryWorkQueue(const DirectoryWorkQueue &) = delete;
+    DirectoryWorkQueue &operator=(const DirectoryWorkQueue &) = delete;
+
+    // Returns a task that is neither finished nor leased by a live worker, std::nullopt if there is none. Thread-safe.
+    std::optional<unsigned int> Claim();
+    // Publish the result of a claimed task and release it. Thread-safe.
+    void Finish(unsigned int taskIdx, const std::string &result);
+    // Release a claimed task without a result, e.g. if it fails. Other workers may still claim it. Thread-safe.
+    void Abandon(unsigned int taskIdx);
+    // Whether this worker has abandoned the task. Thread-safe.
+    bool IsAbandoned(unsigned int taskIdx);
+    bool IsFinished(unsigned int taskIdx) const;
+    // Returns the result of the task in the queue directory if it is finished, does not need a worker.
+    static std::optional<std::string> GetResult(const std::filesystem::path &dir, unsigned int taskIdx);
+};
@@ -0,0 +1,180 @@
+#include "workload.hpp"
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <unordered_set>
+
+// The job specs view the model names, which may outlive the workload, so they must never be freed
+static std::string_view InternModelName(std::string_view modelName) {
+    static std::mutex mtx;
+    static std::unordered_set<std::string> modelNames;
+    std::lock_guard lock(mtx);
+    return *modelNames.emplace(modelName).first;
+}
+
+static std::vector<double> GetWeights(const std::vector<std::pair<unsigned int, unsigned int>> &hostCountWeights) {
+    std::vector<double> weights;
+    for (auto [hostCount, weight] : hostCountWeights)
+        weights.push_back(weight);
+    return weights;
+}
+
+SyntheticWorkload::SyntheticWorkload(const std::vector<std::string> &modelNames,
+                                     const std::vector<std::pair<unsigned int, unsigned int>> &hostCountWeights,
+                                     std::vector<unsigned int> stepCounts, unsigned int jobCount,
+                                     std::optional<double> arrivalRate, unsigned int seed)
+    : m_HostCountSampler(GetWeights(hostCountWeights)), m_StepCounts(std::move(stepCounts)), m_JobCount(jobCount),
+      m_ArrivalRate(arrivalRate), m_Engine(seed) {
+    assert(!modelNames.empty() && !m_StepCounts.empty());
+    assert(!m_ArrivalRate || *m_ArrivalRate > 0.0);
+    for (const auto &modelName : modelNames)
+        m_ModelNames.push_back(InternModelName(modelName));
+    for (auto [hostCount, weight] : hostCountWeights)
+        m_HostCounts.push_back(hostCount);
+}
+
+unsigned int SyntheticWorkload::NextBatch(std::vector<JobSpec> &batch, unsigned int maxCount) {
+    std::uniform_int_distribution<std::size_t> randomModel(0, m_ModelNames.size() - 1);
+    std::uniform_int_distribution<std::size_t> randomStepCount(0, m_StepCounts.size() - 1);
+    unsigned int count = std::min(maxCount, m_JobCount - m_CreatedJobCount);
+    for (unsigned int i = 0; i < count; ++i) {
+        auto modelName = m_ModelNames[randomModel(m_Engine)];
+        auto hostCount = m_HostCounts[m_HostCountSampler(m_Engine)];
+        auto stepCount = m_StepCounts[randomStepCount(m_Engine)];
+        if (m_ArrivalRate)
+            m_LastArrivalTime += std::exponential_distribution<double>(*m_ArrivalRate)(m_Engine);
+        batch.push_back({m_LastArrivalTime, modelName, hostCount, stepCount});
+    }
+    m_CreatedJobCount += count;
+    return count;
+}
+
+// Splits a CSV line without quoting, the fields refer to the line
+static void SplitFields(std::string_view line, std::vector<std::string_view> &fields) {
+    fields.clear();
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+    while (true) {
+        auto pos = line.find(',');
+        fields.push_back(line.substr(0, pos));
+        if (pos == std::string_view::npos)
+            return;
+        line.remove_prefix(pos + 1);
+    }
+}
+
+template <typename T>
+static std::optional<T> ParseNumber(std::string_view field) {
+    while (!field.empty() && field.front() == ' ')
+        field.remove_prefix(1);
+    while (!field.empty() && field.back() == ' ')
+        field.remove_suffix(1);
+    T value;
+    auto [end, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+    if (ec != std::errc() || end != field.data() + field.size())
+        return std::nullopt;
+    return value;
+}
+
+TraceWorkload::TraceWorkload(std::string fileName, std::optional<unsigned int> maxJobCount)
+    : m_FileName(std::move(fileName)), m_File(m_FileName), m_MaxJobCount(maxJobCount) {
+    if (!m_File) {
+        std::cerr << "Cannot open " << m_FileName << "!\n";
+        m_HasError = true;
+        return;
+    }
+    m_HasError = !ReadHeader();
+}
+
+void TraceWorkload::ReportError(std::string_view message) {
+    std::cerr << m_FileName << ':' << m_LineIdx << ": " << message << '\n';
+    m_HasError = true;
+}
+
+bool TraceWorkload::ReadHeader() {
+    if (!std::getline(m_File, m_Line)) {
+        ReportError("Missing header");
+        return false;
+    }
+    ++m_LineIdx;
+    SplitFields(m_Line, m_Fields);
+    auto findColumn = [this](std::string_view name) -> std::optional<unsigned int> {
+        for (unsigned int i = 0; i < m_Fields.size(); ++i)
+            if (m_Fields[i] == name)
+                return i;
+        return std::nullopt;
+    };
+    auto arrivalTimeColumn = findColumn("arrival_time"), hostCountColumn = findColumn("host_count"),
+         modelColumn = findColumn("model"), stepCountColumn = findColumn("step_count");
+    if (!arrivalTimeColumn || !hostCountColumn || !modelColumn || !stepCountColumn) {
+        ReportError("The header must include arrival_time, host_count, model, and step_count");
+        return false;
+    }
+    m_ArrivalTimeColumn = *arrivalTimeColumn;
+    m_HostCountColumn = *hostCountColumn;
+    m_ModelColumn = *modelColumn;
+    m_StepCountColumn = *stepCountColumn;
+    return true;
+}
+
+std::optional<std::string_view> TraceWorkload::ResolveModel(std::string_view model) {
+    // Each model is resolved once, since a trace may have millions of rows
+    auto iter = m_ModelNames.find(model);
+    if (iter != m_ModelNames.end())
+        return iter->second;
+    std::string path(model);
+    if (!std::filesystem::is_regular_file(path))
+        path = "traces/" + path + ".json";
+    if (!std::filesystem::is_regular_file(path))
+        return std::nullopt;
+    auto modelName = InternModelName(path);
+    m_ModelNames.emplace(model, modelName);
+    return modelName;
+}
+
+std::optional<JobSpec> TraceWorkload::ParseRow() {
+    SplitFields(m_Line, m_Fields);
+    auto maxColumn = std::max({m_ArrivalTimeColumn, m_HostCountColumn, m_ModelColumn, m_StepCountColumn});
+    if (m_Fields.size() <= maxColumn) {
+        ReportError("Missing columns");
+        return std::nullopt;
+    }
+    auto arrivalTime = ParseNumber<double>(m_Fields[m_ArrivalTimeColumn]);
+    if (!arrivalTime || *arrivalTime < m_LastArrivalTime) {
+        ReportError("Invalid or unsorted arrival_time");
+        return std::nullopt;
+    }
+    auto hostCount = ParseNumber<unsigned int>(m_Fields[m_HostCountColumn]);
+    auto stepCount = ParseNumber<unsigned int>(m_Fields[m_StepCountColumn]);
+    if (!hostCount || *hostCount == 0 || !stepCount || *stepCount == 0) {
+        ReportError("Invalid host_count or step_count");
+        return std::nullopt;
+    }
+    auto modelName = ResolveModel(m_Fields[m_ModelColumn]);
+    if (!modelName) {
+        ReportError("Unknown model " + std::string(m_Fields[m_ModelColumn]));
+        return std::nullopt;
+    }
+    m_LastArrivalTime = *arrivalTime;
+    return JobSpec{*arrivalTime, *modelName, *hostCount, *stepCount};
+}
+
+unsigned int TraceWorkload::NextBatch(std::vector<JobSpec> &batch, unsigned int maxCount) {
+    unsigned int count = 0;
+    while (!m_HasError && count < maxCount && (!m_MaxJobCount || m_CreatedJobCount < *m_MaxJobCount) &&
+           std::getline(m_File, m_Line)) {
+        ++m_LineIdx;
+        if (m_Line.empty() || m_Line == "\r")
+            continue;
+        auto spec = ParseRow();
+        if (!spec)
+            break;
+        batch.push_back(*spec);
+        ++count;
+        ++m_CreatedJobCount;
+    }
+    return count;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "job.hpp"
+#include "simulation_context.hpp"
+#include "utils/alias_sampler.hpp"
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// A job to submit, independent of any SimulationContext
+struct JobSpec {
+    double ArrivalTime; // In second since the start of the simulation
+    // Interned, valid until the program exits
+    std::string_view ModelName;
+    unsigned int HostCount;
+    std::optional<unsigned int> StepCount;
+};
+
+// Draws jobs independently: the model and the step count uniformly, and the host count by its weight. Jobs arrive as a
+// Poisson process with arrivalRate in jobs per second, or all at time 0 if not given.
+class SyntheticWorkload {
+private:
+    std::vector<std::string_view> m_ModelNames;
+    std::vector<unsigned int> m_HostCounts;
+    AliasSampler m_HostCountSampler;
+    std::vector<unsigned int> m_StepCounts;
+    const unsigned int m_JobCount;
+    const std::optional<double> m_ArrivalRate;
+    unsigned int m_CreatedJobCount = 0;
+    double m_LastArrivalTime = 0.0;
+    std::default_random_engine m_Engine;
+
+public:
+    explicit SyntheticWorkload(const std::vector<std::string> &modelNames,
+                               const std::vector<std::pair<unsigned int, unsigned int>> &hostCountWeights,
+                               std::vector<unsigned int> stepCounts, unsigned int jobCount,
+                               std::optional<double> arrivalRate = std::nullopt, unsigned int seed = 42);
+
+    // Appends at most maxCount jobs to the batch, returns the number of jobs appended, which is 0 once exhausted.
+    unsigned int NextBatch(std::vector<JobSpec> &batch, unsigned int maxCount);
+};
+
+// Replays the jobs in a CSV file, read on demand so that the file may be larger than the memory. The header names the
+// columns, which must include arrival_time (in second), host_count, model, and step_count; the other columns are
+// ignored. A model is either the path to its trace, or a name in traces/. Rows must be sorted by arrival time. Reading
+// stops at the first invalid row.
+class TraceWorkload {
+private:
+    const std::string m_FileName;
+    std::ifstream m_File;
+    std::string m_Line;
+    // The fields of m_Line
+    std::vector<std::string_view> m_Fields;
+    unsigned int m_LineIdx = 0;
+    unsigned int m_ArrivalTimeColumn, m_HostCountColumn, m_ModelColumn, m_StepCountColumn;
+    const std::optional<unsigned int> m_MaxJobCount;
+    unsigned int m_CreatedJobCount = 0;
+    double m_LastArrivalTime = 0.0;
+    // Model in the file -> interned model name, looked up without copying the model
+    std::map<std::string, std::string_view, std::less<>> m_ModelNames;
+    bool m_HasError = false;
+
+    bool ReadHeader();
+    std::optional<JobSpec> ParseRow();
+    std::optional<std::string_view> ResolveModel(std::string_view model);
+    void ReportError(std::string_view message);
+
+public:
+    explicit TraceWorkload(std::string fileName, std::optional<unsigned int> maxJobCount = std::nullopt);
+
+    // Whether the file cannot be read or has an invalid row, which is reported to stderr.
+    bool HasError() const { return m_HasError; }
+    // Appends at most maxCount jobs to the batch, returns the number of jobs appended, which is 0 once exhausted.
+    unsigned int NextBatch(std::vector<JobSpec> &batch, unsigned int maxCount);
+};
+
+// Creates the jobs of the workload in the context for AllocationController, drawing a batch of specs at a time. The
+// workload is shared, since std::function must be copyable but a workload may own a file, and so that the caller can
+// still check it, e.g. TraceWorkload::HasError after the simulation.
+template <typename TWorkload>
+std::function<std::unique_ptr<Job>()> CreateWorkloadJobGenerator(SimulationContext &context,
+                                                                 std::shared_ptr<TWorkload> workload,
+                                                                 unsigned int batchSize = 256) {
+    return [&context, workload = std::move(workload), batchSize, batch = std::vector<JobSpec>(),
+            nextIdx = 0u]() mutable -> std::unique_ptr<Job> {
+        if (nextIdx == batch.size()) {
+            batch.clear();
+            nextIdx = 0;
+            if (workload->NextBatch(batch, batchSize) == 0)
+                return nullptr;
+        }
+        const auto &spec = batch[nextIdx++];
+        return std::make_unique<Job>(context, spec.ModelName, spec.HostCount, spec.StepCount, spec.ArrivalTime);
+    };
+}